@@ -0,0 +1,218 @@
+﻿// Host of the local join service and a thin client for scripts and batch jobs.
+//    IGES.Host serve [workers] [threads] [shared]
+//                                           Serve joins until stopped. threads sizes the OCCT pool,
+//                                           shared runs the engine loops on it
+//    IGES.Host join <left> <right> <out> [ops]
+//                                           Join through the service, starting it when none runs
+//    IGES.Host bench <left> <right> [jobs]  Joins per minute of concurrent jobs for a few settings
+//    IGES.Host generate <left> <right> [c|hat] [length] [holes/m] [spline] [gap]
+//                                           Write a synthetic rail pair, spline is the share of
+//                                           B-spline holes from 0 to 1
+//    IGES.Host batch <jobs> [workers] [timeout s] [memory MB]
+//                                           Join each line left|right|out|ops of the jobs file in its
+//                                           own worker process, so that a crash or a hang costs one job
+//    IGES.Host worker <request>             Run one JOIN request line, as the batch supervisor does
+//    IGES.Host drawing <part> <dxf> [exact] [hidden]
+//                                           Top, side and end views of the part as a DXF
+//    IGES.Host sections <part> [count] [axis]
+//                                           Extent of the sections at count stations along X, Y or Z
+//    IGES.Host features <part>              Faces, holes, slots, notches and cut-outs of the part
+//    IGES.Host selftest [directory]         Round trip checks of the engine on a generated rail pair
+//    IGES.Host ping | stats | stop
+// ops is a comma separated list: align1, yaw2, roll1, glue, speculative, refine, share, budget=60 ..
+// stats prints joined, failed, mean ms, joins per minute and the bytes shared geometry saved
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using FChassis.IGES;
+using Engine = FChassis.IGES.IGES;
+
+string pipe = JoinService.DefaultPipeName ();
+if (args.Length == 0) return Usage ();
+
+switch (args[0].ToLowerInvariant ()) {
+   case "serve":
+      int workers = args.Length > 1 ? int.Parse (args[1]) : Math.Max (1, Environment.ProcessorCount / 4);
+      if (args.Length > 2)
+         Engine.SetConcurrency (int.Parse (args[2]), 0, args.Length > 3 && args[3] == "shared");
+      Console.WriteLine ($"Join service on {pipe} with {workers} workers");
+      JoinService.Run (pipe, workers);
+      return 0;
+
+   case "ping":
+   case "stats":
+   case "stop":
+      string? reply = JoinService.Send (pipe, args[0].ToUpperInvariant (), 2000);
+      Console.WriteLine (reply ?? "No join service is running");
+      return reply == null ? 1 : 0;
+
+   case "join":
+      if (args.Length < 4) return Usage ();
+      string request = $"JOIN {Path.GetFullPath (args[1])}|{Path.GetFullPath (args[2])}|{Path.GetFullPath (args[3])}";
+      if (args.Length > 4) request += "|" + args[4];
+      string? result = JoinService.Send (pipe, request, 2000);
+      if (result == null) {
+         // Start a service in the background and retry once it listens
+         Process.Start (new ProcessStartInfo (Environment.ProcessPath!, "serve") {
+            UseShellExecute = false, CreateNoWindow = true
+         });
+         result = JoinService.Send (pipe, request, 30000);
+      }
+      Console.WriteLine (result ?? "The join service did not start");
+      return result != null && result.StartsWith ("OK") ? 0 : 1;
+
+   case "generate":
+      if (args.Length < 3) return Usage ();
+      bool written = Engine.WriteRails (Path.GetFullPath (args[1]), Path.GetFullPath (args[2]),
+         args.Length > 3 && args[3] == "hat" ? 1 : 0,
+         args.Length > 4 ? double.Parse (args[4]) : 2000, args.Length > 5 ? double.Parse (args[5]) : 10,
+         args.Length > 6 ? double.Parse (args[6]) : 0, args.Length > 7 ? double.Parse (args[7]) : 0);
+      Console.WriteLine (written ? $"Wrote {args[1]} and {args[2]}" : "Writing the rails failed");
+      return written ? 0 : 1;
+
+   case "worker":
+      if (args.Length < 2) return Usage ();
+      string done = JoinService.Execute (args[1]);
+      Console.WriteLine (done);
+      return done.StartsWith ("OK") ? 0 : 1;
+
+   case "batch":
+      if (args.Length < 2) return Usage ();
+      return Batch (args[1], args.Length > 2 ? int.Parse (args[2]) : 0, args.Length > 3 ? int.Parse (args[3]) : 900,
+         args.Length > 4 ? int.Parse (args[4]) : 0);
+
+   case "drawing":
+      if (args.Length < 3) return Usage ();
+      var drawing = new Engine ();
+      drawing.Initialize ();
+      drawing.LoadIGES (Path.GetFullPath (args[1]), 0);
+      bool drawn = drawing.SaveDXF (Path.GetFullPath (args[2]), 0, args.Contains ("exact"), args.Contains ("hidden")) == 0;
+      drawing.Uninitialize ();
+      Console.WriteLine (drawn ? $"Wrote {args[2]}" : "Projecting the views failed");
+      return drawn ? 0 : 1;
+
+   case "sections":
+      if (args.Length < 2) return Usage ();
+      return Sections (Path.GetFullPath (args[1]), args.Length > 2 ? int.Parse (args[2]) : 100,
+         args.Length > 3 ? "xyz".IndexOf (args[3].ToLowerInvariant ()[0]) : 0);
+
+   case "features":
+      if (args.Length < 2) return Usage ();
+      return Features (Path.GetFullPath (args[1]));
+
+   case "selftest":
+      string checks = Engine.SelfTest (args.Length > 1 ? Path.GetFullPath (args[1]) : Path.GetTempPath ());
+      Console.Write (checks);
+      return checks.Contains ("FAIL") ? 1 : 0;
+
+   case "bench":
+      if (args.Length < 3) return Usage ();
+      return Bench (Path.GetFullPath (args[1]), Path.GetFullPath (args[2]),
+         args.Length > 3 ? int.Parse (args[3]) : Math.Max (1, Environment.ProcessorCount / 4));
+}
+return Usage ();
+
+// Run the same join as concurrent jobs, with every job on all the cores, with the cores split
+// between the jobs, and split on the shared OCCT pool
+static int Bench (string left, string right, int jobs) {
+   int cores = Environment.ProcessorCount, share = Math.Max (1, cores / jobs);
+   var engines = Enumerable.Range (0, jobs).Select (_ => { var e = new Engine (); e.Initialize (); return e; }).ToArray ();
+   var settings = new (string Name, int JobThreads, bool Shared)[] {
+      ("all cores per job", 0, false), ($"{share} threads per job", share, false), ($"{share} per job, shared", share, true)
+   };
+   Console.WriteLine ($"{jobs} concurrent jobs on {cores} cores");
+   foreach (var (name, jobThreads, shared) in settings) {
+      Engine.SetConcurrency (0, jobThreads, shared);
+      int failed = 0;
+      var watch = Stopwatch.StartNew ();
+      Parallel.For (0, jobs, new ParallelOptions { MaxDegreeOfParallelism = jobs }, i => {
+         try {
+            engines[i].LoadIGES (left, 0);
+            engines[i].LoadIGES (right, 1);
+            engines[i].UnionShapes ();
+         } catch (Exception) {
+            Interlocked.Increment (ref failed);
+         }
+      });
+      double minutes = watch.Elapsed.TotalMinutes;
+      Console.WriteLine ($"{name,-24} {(jobs - failed) / minutes,8:F1} joins/min  {watch.ElapsedMilliseconds,8} ms  {failed} failed");
+   }
+   foreach (var engine in engines) engine.Uninitialize ();
+   return 0;
+}
+
+// Run the jobs of the file through the supervisor, one worker process per attempt, and retry
+// the ones that crashed once
+static int Batch (string jobsFile, int workers, int timeout, int memoryMB) {
+   var requests = File.ReadAllLines (jobsFile).Where (line => line.Trim ().Length > 0 && !line.StartsWith ('#')).Select (line => {
+      string[] parts = line.Split ('|');
+      string request = "JOIN " + string.Join ('|', parts.Take (3).Select (part => Path.GetFullPath (part.Trim ())));
+      return parts.Length > 3 ? request + "|" + parts[3].Trim () : request;
+   }).ToArray ();
+   var watch = Stopwatch.StartNew ();
+   string[] results = JoinSupervisor.Run (Environment.ProcessPath!, requests, workers, timeout, memoryMB, 1);
+   int done = 0;
+   for (int i = 0; i < results.Length; i++) {
+      Console.WriteLine ($"{requests[i].Substring (5)}\n   {results[i]}");
+      if (results[i].StartsWith ("Done")) done++;
+   }
+   Console.WriteLine ($"{done} of {results.Length} joined in {watch.ElapsedMilliseconds} ms");
+   return done == results.Length ? 0 : 1;
+}
+
+// Width and height of the sections in their plane, station by station
+static int Sections (string part, int count, int axis) {
+   if (axis < 0) return Usage ();
+   var engine = new Engine ();
+   engine.Initialize ();
+   engine.LoadIGES (part, 0);
+   var watch = Stopwatch.StartNew ();
+   double[] buffer = engine.Slice (0, axis, null, count);
+   long ms = watch.ElapsedMilliseconds;
+   engine.Uninitialize ();
+   for (int i = 0; i < buffer.Length;) {
+      double station = buffer[i];
+      int polylines = (int)buffer[i + 1];
+      i += 2;
+      double umin = double.MaxValue, umax = double.MinValue, vmin = double.MaxValue, vmax = double.MinValue;
+      for (int p = 0; p < polylines; p++) {
+         int points = (int)buffer[i++];
+         for (int k = 0; k < points; k++, i += 2) {
+            umin = Math.Min (umin, buffer[i]); umax = Math.Max (umax, buffer[i]);
+            vmin = Math.Min (vmin, buffer[i + 1]); vmax = Math.Max (vmax, buffer[i + 1]);
+         }
+      }
+      Console.WriteLine (polylines == 0 ? $"{station,10:F1}  empty"
+         : $"{station,10:F1}  {polylines,3} polylines  width {umax - umin,8:F2}  height {vmax - vmin,8:F2}");
+   }
+   Console.WriteLine ($"{count} sections in {ms} ms");
+   return 0;
+}
+
+// Read the feature table in place, rows as laid out in FeatureRecognizer.h
+static int Features (string part) {
+   string[] kinds = ["Face", "Hole", "Slot", "Notch", "CutOut"], planes = ["YNeg", "YPos", "Top", "Flex"];
+   var engine = new Engine ();
+   engine.Initialize ();
+   engine.LoadIGES (part, 0);
+   var watch = Stopwatch.StartNew ();
+   IntPtr table = engine.RecognizeFeatures (0, out int count);
+   long ms = watch.ElapsedMilliseconds;
+   var tally = new SortedDictionary<string, int> ();
+   for (int i = 0; i < count; i++) {
+      IntPtr row = table + i * Engine.FeatureRecordSize;
+      string kind = kinds[Marshal.ReadInt32 (row)], plane = planes[Marshal.ReadInt32 (row, 4)];
+      double Read (int offset) => BitConverter.Int64BitsToDouble (Marshal.ReadInt64 (row, offset));
+      tally[$"{kind,-7}{plane}"] = tally.GetValueOrDefault ($"{kind,-7}{plane}") + 1;
+      if (kind != "Face")
+         Console.WriteLine ($"{kind,-7}{plane,-5} at ({Read (16),9:F2} {Read (24),8:F2} {Read (32),8:F2})  {Read (64),8:F2} x {Read (72),6:F2}");
+   }
+   engine.Uninitialize ();
+   foreach (var (name, n) in tally) Console.WriteLine ($"{name,-12} {n,6}");
+   Console.WriteLine ($"{count} rows in {ms} ms");
+   return 0;
+}
+
+static int Usage () {
+   Console.WriteLine ("Usage: IGES.Host serve [workers] [threads] [shared] | join <left> <right> <out> [ops] | batch <jobs> [workers] [timeout s] [memory MB] | worker <request> | bench <left> <right> [jobs] | generate <left> <right> [c|hat] [length] [holes/m] [spline] [gap] | drawing <part> <dxf> [exact] [hidden] | sections <part> [count] [axis] | features <part> | selftest [directory] | ping | stats | stop");
+   return 1;
+}
@@ -7,6 +7,12 @@
 #include <msclr/marshal_cppstd.h>
 
 #include "priv/IGESNative.h"
+#include "priv/FeatureRecognizer.h"
+#include "priv/JoinService.h"
+#include "priv/JoinSupervisor.h"
+#include "priv/Projection.h"
+#include "priv/RailGenerator.h"
+#include "priv/Slicer.h"
 #include "IGES.CLI.h"
 
 using namespace System;
@@ -60,8 +66,54 @@ namespace FChassis::IGES {
       this->pPriv->InitView(parentHwnd);
    }
 
+   void IGES::SetConcurrency(int threads, int jobThreads, bool sharedPool) {
+      ConcurrencyOptions options;
+      options.threads = threads;
+      options.jobThreads = jobThreads;
+      options.sharedPool = sharedPool;
+      IGESNative::SetConcurrency(options);
+   }
+
+   void IGES::GetConcurrency([System::Runtime::InteropServices::Out] int% threads,
+      [System::Runtime::InteropServices::Out] int% jobThreads,
+      [System::Runtime::InteropServices::Out] bool% sharedPool) {
+      ConcurrencyOptions options = IGESNative::GetConcurrency();
+      threads = options.threads;
+      jobThreads = options.jobThreads;
+      sharedPool = options.sharedPool;
+   }
+
    void IGES::GetErrorMessage([System::Runtime::InteropServices::Out] System::String^% message) {
-      message = gcnew String(g_Status.error.data());
+      if (this->pPriv)
+         message = gcnew String(this->pPriv->GetErrorMessage().data());
+      else
+         message = gcnew String(g_Status.error.data());
+   }
+
+   void IGES::GetMemoryUsage([System::Runtime::InteropServices::Out] array<System::Int64>^% slotBytes,
+      [System::Runtime::InteropServices::Out] array<System::Int64>^% sharedGeometryBytes,
+      [System::Runtime::InteropServices::Out] System::Int64% workingSet,
+      [System::Runtime::InteropServices::Out] System::Int64% peakWorkingSet) {
+      assert(this->pPriv);
+      MemoryReport report = this->pPriv->GetMemoryReport();
+      slotBytes = gcnew array<System::Int64>(3);
+      sharedGeometryBytes = gcnew array<System::Int64>(3);
+      for (int i = 0; i < 3; i++) {
+         slotBytes[i] = (System::Int64)report.slotBytes[i];
+         sharedGeometryBytes[i] = (System::Int64)report.sharedGeometryBytes[i];
+      }
+      workingSet = (System::Int64)report.workingSet;
+      peakWorkingSet = (System::Int64)report.peakWorkingSet;
+   }
+
+   void IGES::GetLastOperationMemory([System::Runtime::InteropServices::Out] System::String^% operation,
+      [System::Runtime::InteropServices::Out] System::Int64% workingSetDelta,
+      [System::Runtime::InteropServices::Out] System::Int64% peakWorkingSet) {
+      assert(this->pPriv);
+      MemoryReport report = this->pPriv->GetMemoryReport();
+      operation = gcnew String(report.lastOperation.data());
+      workingSetDelta = report.operationDelta;
+      peakWorkingSet = (System::Int64)report.operationPeak;
    }
 
    void IGES::Zoom(bool zoomIn, int x, int y) {
@@ -89,6 +141,116 @@ namespace FChassis::IGES {
       return 0;
    }
 
+   static RailSpec MakeRailSpec(int section, double length, double holesPerMetre, double splineFraction, double gap) {
+      RailSpec spec;
+      spec.section = section == 1 ? RailSpec::HatSection : RailSpec::CChannel;
+      spec.length = length;
+      spec.holesPerMetre = holesPerMetre;
+      spec.splineFraction = splineFraction;
+      spec.gap = gap;
+      return spec;
+   }
+
+   int IGES::GenerateRails(int section, double length, double holesPerMetre, double splineFraction, double gap) {
+      assert(this->pPriv);
+      return this->pPriv->GenerateRails(MakeRailSpec(section, length, holesPerMetre, splineFraction, gap));
+   }
+
+   bool IGES::WriteRails(System::String^ leftPath, System::String^ rightPath, int section, double length,
+      double holesPerMetre, double splineFraction, double gap) {
+      std::string left = msclr::interop::marshal_as<std::string>(leftPath);
+      std::string right = msclr::interop::marshal_as<std::string>(rightPath);
+      try {
+         return WriteRailPair(MakeRailSpec(section, length, holesPerMetre, splineFraction, gap), left, right);
+      }
+      catch (const std::exception& ex) {
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      catch (...) {
+         throw gcnew System::Exception("An unknown error occurred while generating the rails.");
+      }
+   }
+
+   System::String^ IGES::SelfTest(System::String^ directory) {
+      std::string report;
+      try {
+         IGESNative::SelfTest(msclr::interop::marshal_as<std::string>(directory), report);
+      }
+      catch (const std::exception& ex) {
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      catch (...) {
+         throw gcnew System::Exception("An unknown error occurred while running the self test.");
+      }
+      return gcnew String(report.data());
+   }
+
+   array<double>^ IGES::ProjectViews(int order, bool exact, bool hidden) {
+      assert(this->pPriv);
+      ProjectionOptions options;
+      options.exact = exact;
+      options.hidden = hidden;
+      std::vector<ProjectedSegment> segments;
+      if (this->pPriv->ProjectViews(order, options, segments))
+         throw gcnew System::Exception(gcnew System::String(this->pPriv->GetErrorMessage().data()));
+
+      array<double>^ buffer = gcnew array<double>((int)segments.size() * 6);
+      for (int i = 0; i < (int)segments.size(); i++) {
+         const ProjectedSegment& s = segments[i];
+         buffer[6 * i] = (int)s.view;
+         buffer[6 * i + 1] = s.hidden ? 1 : 0;
+         buffer[6 * i + 2] = s.x0;
+         buffer[6 * i + 3] = s.y0;
+         buffer[6 * i + 4] = s.x1;
+         buffer[6 * i + 5] = s.y1;
+      }
+      return buffer;
+   }
+
+   int IGES::SaveDXF(System::String^ filePath, int order, bool exact, bool hidden) {
+      assert(this->pPriv);
+      ProjectionOptions options;
+      options.exact = exact;
+      options.hidden = hidden;
+      std::string stdFilePath = msclr::interop::marshal_as<std::string>(filePath);
+      return this->pPriv->SaveDXF(stdFilePath, order, options);
+   }
+
+   array<double>^ IGES::Slice(int order, int axis, array<double>^ stations, int count) {
+      assert(this->pPriv);
+      SliceOptions options;
+      options.axis = axis;
+      options.evenStations = count;
+      std::vector<double> stdStations;
+      if (stations != nullptr)
+         for each (double station in stations)
+            stdStations.push_back(station);
+      std::vector<double> buffer;
+      if (this->pPriv->SliceSections(order, stdStations, options, buffer))
+         throw gcnew System::Exception(gcnew System::String(this->pPriv->GetErrorMessage().data()));
+
+      array<double>^ result = gcnew array<double>((int)buffer.size());
+      if (!buffer.empty())
+         System::Runtime::InteropServices::Marshal::Copy(System::IntPtr(buffer.data()), result, 0, (int)buffer.size());
+      return result;
+   }
+
+   System::IntPtr IGES::RecognizeFeatures(int order, [System::Runtime::InteropServices::Out] int% count) {
+      assert(this->pPriv);
+      if (this->pPriv->RecognizeFeatures(order, FeatureOptions()))
+         throw gcnew System::Exception(gcnew System::String(this->pPriv->GetErrorMessage().data()));
+
+      int rows = 0;
+      const FeatureRecord* table = this->pPriv->GetFeatures(rows);
+      count = rows;
+      return System::IntPtr(const_cast<FeatureRecord*>(table));
+   }
+
+   bool IGES::IsLoading(int order) {
+      assert(this->pPriv);
+      return this->pPriv->IsLoading(order);
+   }
+
    int IGES::SaveIGES(System::String^ filePath, int order) {
       assert(this->pPriv);
 
@@ -123,6 +285,49 @@ namespace FChassis::IGES {
       return 0;
    }
 
+   System::String^ IGES::BudgetedJoin(double budgetSeconds, [System::Runtime::InteropServices::Out] System::String^% stages) {
+      assert(this->pPriv);
+      JoinBudgetReport report;
+      try {
+         pPriv->BudgetedJoin(budgetSeconds, report);
+      }
+      catch (const NoPartLoadedException& ex) {
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      catch (const std::exception& ex) { // Catch other standard exceptions
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      catch (...) {
+         throw gcnew System::Exception("An unknown error occurred while joining the parts.");
+      }
+      stages = gcnew String(report.stages.data());
+      switch (report.path) {
+         case JoinBudgetReport::Full: return "full";
+         case JoinBudgetReport::Glue: return "glue";
+         case JoinBudgetReport::Compound: return "compound";
+      }
+      return "none";
+   }
+
+   int IGES::MirrorJoin(int order) {
+      assert(this->pPriv);
+      try {
+         return pPriv->MirrorJoin(order);
+      }
+      catch (const NoPartLoadedException& ex) {
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      catch (const FuseFailureException& ex) {
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      catch (const std::exception& ex) { // Catch other standard exceptions
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      catch (...) {
+         throw gcnew System::Exception("An unknown error occurred while mirroring and joining the part.");
+      }
+   }
+
    int IGES::AlignToXYPlane(int order) {
       assert(this->pPriv);
       return this->pPriv->AlignToXYPlane(order);
@@ -175,6 +380,130 @@ namespace FChassis::IGES {
       }
    }
 
+   void IGES::SetLocalRefine(bool enable) {
+      assert(this->pPriv);
+      JoinOptions options = this->pPriv->GetJoinOptions();
+      options.localRefine = enable;
+      this->pPriv->SetJoinOptions(options);
+   }
+
+   void IGES::SetSpeculativeFuse(bool enable) {
+      assert(this->pPriv);
+      JoinOptions options = this->pPriv->GetJoinOptions();
+      options.speculativeFuse = enable;
+      this->pPriv->SetJoinOptions(options);
+   }
+
+   void IGES::SetGlueJoin(bool enable) {
+      assert(this->pPriv);
+      JoinOptions options = this->pPriv->GetJoinOptions();
+      options.glueJoin = enable;
+      this->pPriv->SetJoinOptions(options);
+   }
+
+   void IGES::SetMemoryPressureMode(bool enable) {
+      assert(this->pPriv);
+      JoinOptions options = this->pPriv->GetJoinOptions();
+      options.parkInputs = enable;
+      this->pPriv->SetJoinOptions(options);
+   }
+
+   void IGES::SetJoinCache(bool enable) {
+      assert(this->pPriv);
+      JoinOptions options = this->pPriv->GetJoinOptions();
+      options.useCache = enable;
+      this->pPriv->SetJoinOptions(options);
+   }
+
+   void IGES::SetJoinPreflight(bool enable) {
+      assert(this->pPriv);
+      JoinOptions options = this->pPriv->GetJoinOptions();
+      options.preflight = enable;
+      this->pPriv->SetJoinOptions(options);
+   }
+
+   void IGES::SetFastVerify(bool enable) {
+      assert(this->pPriv);
+      JoinOptions options = this->pPriv->GetJoinOptions();
+      options.fastVerify = enable;
+      this->pPriv->SetJoinOptions(options);
+   }
+
+   bool IGES::CheckJoin([System::Runtime::InteropServices::Out] double% overlap,
+      [System::Runtime::InteropServices::Out] System::String^% suggestion) {
+      assert(this->pPriv);
+      JoinCheck check;
+      try {
+         this->pPriv->CheckJoin(check);
+      }
+      catch (const std::exception& ex) {
+         throw gcnew System::Exception(gcnew System::String(ex.what()));
+      }
+      overlap = check.overlap;
+      suggestion = gcnew String(check.suggestion.data());
+      return check.contact;
+   }
+
+   void IGES::SetCanonicalGeometry(bool enable) {
+      assert(this->pPriv);
+      LoadOptions options = this->pPriv->GetLoadOptions();
+      options.canonicalGeometry = enable;
+      this->pPriv->SetLoadOptions(options);
+   }
+
+   void IGES::SetShareGeometry(bool enable) {
+      assert(this->pPriv);
+      LoadOptions options = this->pPriv->GetLoadOptions();
+      options.shareGeometry = enable;
+      this->pPriv->SetLoadOptions(options);
+   }
+
+   void IGES::SetFastReader(bool enable) {
+      assert(this->pPriv);
+      LoadOptions options = this->pPriv->GetLoadOptions();
+      options.fastReader = enable;
+      this->pPriv->SetLoadOptions(options);
+   }
+
+   void IGES::SetProgressiveLoad(bool enable) {
+      assert(this->pPriv);
+      LoadOptions options = this->pPriv->GetLoadOptions();
+      options.progressiveLoad = enable;
+      this->pPriv->SetLoadOptions(options);
+   }
+
+   void IGES::SetExportCompaction(bool enable) {
+      assert(this->pPriv);
+      ExportOptions options = this->pPriv->GetExportOptions();
+      options.compact = enable;
+      this->pPriv->SetExportOptions(options);
+   }
+
+   void IGES::GetExportReport([System::Runtime::InteropServices::Out] array<System::Int64>^% before,
+      [System::Runtime::InteropServices::Out] array<System::Int64>^% after,
+      [System::Runtime::InteropServices::Out] int% entities,
+      [System::Runtime::InteropServices::Out] System::Int64% fileBytes) {
+      assert(this->pPriv);
+      ExportReport report = this->pPriv->GetExportReport();
+      before = gcnew array<System::Int64>{ report.faces[0], report.edges[0], report.vertices[0],
+         (System::Int64)report.shapeBytes[0] };
+      after = gcnew array<System::Int64>{ report.faces[1], report.edges[1], report.vertices[1],
+         (System::Int64)report.shapeBytes[1] };
+      entities = report.entities;
+      fileBytes = (System::Int64)report.fileBytes;
+   }
+
+   void IGES::SetTargetedHealing(bool enable) {
+      assert(this->pPriv);
+      LoadOptions loadOptions = this->pPriv->GetLoadOptions();
+      loadOptions.targetedHealing = enable;
+      this->pPriv->SetLoadOptions(loadOptions);
+
+      JoinOptions joinOptions = this->pPriv->GetJoinOptions();
+      joinOptions.targetedHealing = enable;
+      this->pPriv->SetJoinOptions(joinOptions);
+   }
+
    int IGES::UndoJoin() {
       assert(this->pPriv);
       int errorNo = this->pPriv->UndoJoin();
@@ -183,6 +512,79 @@ namespace FChassis::IGES {
       return errorNo;
    }
 
+   int IGES::Undo() {
+      assert(this->pPriv);
+      int errorNo = this->pPriv->Undo();
+      if (0 == errorNo)
+         this->Redraw();
+      return errorNo;
+   }
+
+   int IGES::Redo() {
+      assert(this->pPriv);
+      int errorNo = this->pPriv->Redo();
+      if (0 == errorNo)
+         this->Redraw();
+      return errorNo;
+   }
+
+   bool IGES::CanUndo() {
+      assert(this->pPriv);
+      return this->pPriv->CanUndo();
+   }
+
+   bool IGES::CanRedo() {
+      assert(this->pPriv);
+      return this->pPriv->CanRedo();
+   }
+
+   System::String^ JoinService::DefaultPipeName() {
+      return gcnew String(::JoinService::DefaultPipeName);
+   }
+
+   void JoinService::Run(System::String^ pipeName, int workerCount) {
+      std::string stdPipeName = msclr::interop::marshal_as<std::string>(pipeName);
+      ::JoinService service(stdPipeName, workerCount);
+      service.Run();
+   }
+
+   System::String^ JoinService::Send(System::String^ pipeName, System::String^ request, int connectTimeoutMs) {
+      std::string stdPipeName = msclr::interop::marshal_as<std::string>(pipeName);
+      std::string stdRequest = msclr::interop::marshal_as<std::string>(request);
+      std::string reply;
+      if (!SendJoinRequest(stdPipeName, stdRequest, reply, connectTimeoutMs))
+         return nullptr;
+      return gcnew String(reply.data());
+   }
+
+   System::String^ JoinService::Execute(System::String^ request) {
+      std::string stdRequest = msclr::interop::marshal_as<std::string>(request);
+      return gcnew String(ExecuteJoinRequest(stdRequest).data());
+   }
+
+   array<System::String^>^ JoinSupervisor::Run(System::String^ workerPath, array<System::String^>^ requests,
+      int workers, int timeoutSeconds, int memoryLimitMB, int retries) {
+      std::vector<std::string> stdRequests;
+      for each (System::String^ request in requests)
+         stdRequests.push_back(msclr::interop::marshal_as<std::string>(request));
+
+      SupervisorOptions options;
+      options.workers = workers;
+      options.timeoutSeconds = timeoutSeconds;
+      options.memoryLimitMB = memoryLimitMB > 0 ? (std::size_t)memoryLimitMB : 0;
+      options.retries = retries;
+      std::vector<SupervisedJob> jobs = RunSupervised(msclr::interop::marshal_as<std::string>(workerPath),
+         stdRequests, options);
+
+      array<System::String^>^ results = gcnew array<System::String^>((int)jobs.size());
+      for (int i = 0; i < (int)jobs.size(); i++) {
+         std::string line = std::string(OutcomeName(jobs[i].outcome)) + " " + std::to_string(jobs[i].attempts)
+            + " " + std::to_string(jobs[i].ms) + " " + jobs[i].reply;
+         results[i] = gcnew String(line.data());
+      }
+      return results;
+   }
+
    //int IGES::GetShape(int shapeType, int width, int height, array<unsigned char>^% rData) {
    //   std::vector<unsigned char> pngData;
    //
@@ -20,6 +20,36 @@ namespace FChassis::IGES {
       int LoadIGES(System::String^ filePath, int shapeType);
       int SaveIGES(System::String^ filePath, int shapeType);
 
+      // Synthetic rail pair for scaling tests, into parts 1 and 2 or written to IGES files.
+      // section 0 is a C channel, 1 a hat section; the other dimensions keep their defaults
+      int GenerateRails(int section, double length, double holesPerMetre, double splineFraction, double gap);
+      static bool WriteRails(System::String^ leftPath, System::String^ rightPath, int section, double length,
+         double holesPerMetre, double splineFraction, double gap);
+
+      // Round trip checks of the engine on a generated rail pair, written to the directory.
+      // One line per check: PASS or FAIL, the check and what it measured
+      static System::String^ SelfTest(System::String^ directory);
+
+      // Hidden line top, side and end views of a part, laid out on one sheet for shop drawings
+      // and nesting. exact projects the B-rep, else its mesh; hidden keeps the hidden lines.
+      // ProjectViews returns view (0 top, 1 side, 2 end), hidden, x0, y0, x1, y1 per segment
+      array<double>^ ProjectViews(int shapeType, bool exact, bool hidden);
+      int SaveDXF(System::String^ filePath, int shapeType, bool exact, bool hidden);
+
+      // Sections of a part at the stations along the axis (0 X, 1 Y, 2 Z), or at count even
+      // stations when stations is null. The buffer holds per station: station, polyline count,
+      // then per polyline: point count, u0, v0, u1, v1 .. in the cutting plane, see Slicer.h
+      array<double>^ Slice(int shapeType, int axis, array<double>^ stations, int count);
+
+      // Faces, holes, slots, notches and cut-outs of a part, recognized on the shape the engine
+      // holds. Returns the table in place: count rows of FeatureRecordSize bytes laid out as in
+      // FeatureRecognizer.h, valid until the next recognition or Uninitialize
+      System::IntPtr RecognizeFeatures(int shapeType, [System::Runtime::InteropServices::Out] int% count);
+      literal int FeatureRecordSize = 80; // sizeof(FeatureRecord)
+
+      // True while a progressive load still heals the part. Commands on it wait for the healing
+      bool IsLoading(int shapeType);
+
       int AlignToXYPlane(int shapeType);
 
       //int GetShape(int shapeType, int width, int height, array<unsigned char>^% rData);
@@ -31,11 +61,94 @@ namespace FChassis::IGES {
       int SaveAsIGS(System::String^ filePath);
 
       int UnionShapes();
+      // Join within the budget, falling back to a glue join and then to a compound of the parts.
+      // Returns the path taken: full, glue or compound. stages has a line per stage tried
+      System::String^ BudgetedJoin(double budgetSeconds, [System::Runtime::InteropServices::Out] System::String^% stages);
+      int MirrorJoin(int order);
       int UndoJoin();
+      int Undo();
+      int Redo();
+      bool CanUndo();
+      bool CanRedo();
+
+      // Join options
+      void SetLocalRefine(bool enable);
+      void SetSpeculativeFuse(bool enable);
+      void SetGlueJoin(bool enable);
+      void SetMemoryPressureMode(bool enable);
+      void SetJoinCache(bool enable);
+      void SetJoinPreflight(bool enable);
+      void SetFastVerify(bool enable);
+
+      // Pre-flight of the join on the end caps: false when they do not meet in one patch.
+      // suggestion names the rotation likely missing
+      bool CheckJoin([System::Runtime::InteropServices::Out] double% overlap,
+         [System::Runtime::InteropServices::Out] System::String^% suggestion);
+
+      // Load options
+      void SetCanonicalGeometry(bool enable);
+      void SetShareGeometry(bool enable);
+      void SetFastReader(bool enable);
+      void SetProgressiveLoad(bool enable);
+
+      // Export options: compact the model before SaveIGES and SaveAsIGS write it
+      void SetExportCompaction(bool enable);
+
+      // Last export. before and after hold the faces, edges, vertices and estimated bytes of
+      // the model around the compaction, zero when it was not compacted
+      void GetExportReport([System::Runtime::InteropServices::Out] array<System::Int64>^% before,
+         [System::Runtime::InteropServices::Out] array<System::Int64>^% after,
+         [System::Runtime::InteropServices::Out] int% entities,
+         [System::Runtime::InteropServices::Out] System::Int64% fileBytes);
+
+      // Heal only the faces the analyzer reports, on load and after the join
+      void SetTargetedHealing(bool enable);
+
+      // Engine-wide concurrency: threads of the OCCT pool, threads per command (0 for all)
+      // and whether the engine loops share the OCCT pool instead of OpenMP
+      static void SetConcurrency(int threads, int jobThreads, bool sharedPool);
+      static void GetConcurrency([System::Runtime::InteropServices::Out] int% threads,
+         [System::Runtime::InteropServices::Out] int% jobThreads,
+         [System::Runtime::InteropServices::Out] bool% sharedPool);
 
       void GetErrorMessage([System::Runtime::InteropServices::Out] System::String^% message);
 
+      // Memory accounting. slotBytes holds the Left, Right and Fused estimates, sharedGeometryBytes
+      // what sharing the repeated geometry saved on the loaded parts
+      void GetMemoryUsage([System::Runtime::InteropServices::Out] array<System::Int64>^% slotBytes,
+         [System::Runtime::InteropServices::Out] array<System::Int64>^% sharedGeometryBytes,
+         [System::Runtime::InteropServices::Out] System::Int64% workingSet,
+         [System::Runtime::InteropServices::Out] System::Int64% peakWorkingSet);
+      void GetLastOperationMemory([System::Runtime::InteropServices::Out] System::String^% operation,
+         [System::Runtime::InteropServices::Out] System::Int64% workingSetDelta,
+         [System::Runtime::InteropServices::Out] System::Int64% peakWorkingSet);
+
       private:
       IGESNative* pPriv = nullptr;
    };
+
+   // Local join service keeping warm engines behind a named pipe. See priv/JoinService.h
+   // for the request lines
+   public ref class JoinService {
+      public:
+      static System::String^ DefaultPipeName();
+
+      // Serve on the calling thread until a STOP request arrives
+      static void Run(System::String^ pipeName, int workerCount);
+
+      // Send one request line. Returns nullptr when no service answers on the pipe
+      static System::String^ Send(System::String^ pipeName, System::String^ request, int connectTimeoutMs);
+
+      // Run one JOIN request line in this process, as a supervised worker does
+      static System::String^ Execute(System::String^ request);
+   };
+
+   public ref class JoinSupervisor {
+      public:
+      // Run the JOIN request lines in crash-isolated workers started as: workerPath worker "<request>".
+      // One line per request: <outcome> <attempts> <milliseconds> <reply>, where outcome is
+      // Done, Failed, TimedOut, OutOfMemory or Crashed
+      static array<System::String^>^ Run(System::String^ workerPath, array<System::String^>^ requests,
+         int workers, int timeoutSeconds, int memoryLimitMB, int retries);
+   };
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <BRepAlgoAPI_Fuse.hxx>
 #include <BRepBuilderAPI_Transform.hxx>
 #include <BRepBndLib.hxx>
+#include <BRepGProp.hxx>
+#include <GProp_GProps.hxx>
 #include <BRepTools.hxx>
 #include <BRep_Builder.hxx>
 #include <BRep_Tool.hxx>
@@ -26,6 +28,8 @@
 #include <Message_Report.hxx>
 #include <Message_Alert.hxx>
 #include <Message_Msg.hxx>
+#include <Message_ProgressIndicator.hxx>
+#include <Message_ProgressScope.hxx>
 
 #include <IGESControl_Reader.hxx>
 #include <IGESControl_Writer.hxx>
@@ -38,6 +42,8 @@
 #include <TopAbs_ShapeEnum.hxx>
 #include <TopoDS_Face.hxx>
 #include <TopTools_IndexedMapOfShape.hxx>
+#include <TopTools_IndexedDataMapOfShapeListOfShape.hxx>
+#include <TopTools_MapOfShape.hxx>
 #include <TopExp.hxx>
 #include <TopoDS.hxx>
 #include <TopoDS_Iterator.hxx>   // For iterating through compounds
@@ -62,17 +68,66 @@
 #include <Geom_SurfaceOfRevolution.hxx>
 #include <GeomLProp_SurfaceTool.hxx>
 #include <Geom_Surface.hxx>
+#include <Geom_ElementarySurface.hxx>
+#include <Geom_Plane.hxx>
+#include <Geom_CylindricalSurface.hxx>
+#include <Geom_ConicalSurface.hxx>
+#include <Geom_SphericalSurface.hxx>
+#include <Geom_ToroidalSurface.hxx>
+#include <Geom_Conic.hxx>
+#include <Geom_Circle.hxx>
+#include <Geom_Ellipse.hxx>
+#include <Geom2d_Curve.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <TopLoc_Datum3D.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Poly_PolygonOnTriangulation.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <StdPrs_ToolTriangulatedShape.hxx>
 #include <GeomAPI_ProjectPointOnSurf.hxx>
 #include <GeomAPI_IntCS.hxx>
 #include <Geom_Line.hxx>
 #include <Geom_TrimmedCurve.hxx>
 #include <GeomConvert.hxx>
 #include <GeomConvert_CompCurveToBSplineCurve.hxx>
+#include <GeomConvert_SurfToAnaSurf.hxx>
+#include <GeomConvert_CurveToAnaCurve.hxx>
+#include <GeomAdaptor_Curve.hxx>
 
 #include <Standard_Handle.hxx>
 #include <ShapeUpgrade_UnifySameDomain.hxx>
 
 #include <ShapeFix_Shape.hxx>
 #include <ShapeFix_Shell.hxx>
+#include <ShapeFix_Face.hxx>
+#include <ShapeBuild_ReShape.hxx>
+#include <BRepTools_History.hxx>
+#include <BinTools.hxx>
+#include <Geom_BSplineSurface.hxx>
+#include <Geom_BSplineCurve.hxx>
+#include <OSD_ThreadPool.hxx>
+#include <OSD_Parallel.hxx>
+#include <NCollection_IncAllocator.hxx>
+#include <BOPAlgo_PaveFiller.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <IGESData_IGESModel.hxx>
+#include <IGESData_IGESReaderData.hxx>
+#include <IGESData_IGESReaderTool.hxx>
+#include <IGESData_FileRecognizer.hxx>
+#include <IGESData_Protocol.hxx>
+#include <Interface_ParamType.hxx>
+#include <XSControl_WorkSession.hxx>
+#include <HLRAlgo_Projector.hxx>
+#include <HLRBRep_Algo.hxx>
+#include <HLRBRep_HLRToShape.hxx>
+#include <HLRBRep_PolyAlgo.hxx>
+#include <HLRBRep_PolyHLRToShape.hxx>
+#include <GCPnts_QuasiUniformDeflection.hxx>
+#include <BRepAlgoAPI_Section.hxx>
+#include <BRepTools_WireExplorer.hxx>
+#include <ShapeAnalysis_FreeBounds.hxx>
+#include <TopTools_HSequenceOfShape.hxx>
+#include <gp_Pln.hxx>
+#include <BRepAdaptor_Surface.hxx>
 
 #include <tcl.h>
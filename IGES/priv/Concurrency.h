@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <omp.h>
+
+#include <OSD_Parallel.hxx>
+#include <OSD_ThreadPool.hxx>
+
+#include "IGESNative.h"
+
+// Engine-wide concurrency. The parallel loops of the engine all go through For: an OpenMP
+// team of JobThreads, or with sharedPool a launcher on the OCCT pool the booleans run on,
+// so that several jobs in one process do not oversubscribe the cores
+class Concurrency {
+   public:
+   static void Set(const ConcurrencyOptions& options) {
+      std::lock_guard<std::mutex> lock(mutex);
+      current = options;
+      int poolThreads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+      // Init brings the threads of the pool down and up again, only done for a new size
+      const Handle(OSD_ThreadPool)& pool = OSD_ThreadPool::DefaultPool();
+      if (pool->NbThreads() != poolThreads)
+         pool->Init(poolThreads);
+      OSD_Parallel::SetUseOcctThreads(options.sharedPool ? Standard_True : Standard_False);
+
+      int job = options.jobThreads > 0 ? std::min(options.jobThreads, poolThreads) : poolThreads;
+      jobThreads = std::max(1, job);
+      sharedPool = options.sharedPool;
+   }
+
+   static ConcurrencyOptions Get() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return current;
+   }
+
+   // Threads one command may use for its own loops
+   static int JobThreads() {
+      int threads = jobThreads.load();
+      return threads > 0 ? threads : std::max(1, (int)std::thread::hardware_concurrency());
+   }
+
+   // Run body(i) for every i in [0, count)
+   template <class Body>
+   static void For(int count, const Body& body) {
+      if (count <= 0)
+         return;
+      int threads = std::min(count, JobThreads());
+      if (sharedPool) {
+         OSD_ThreadPool::Launcher launcher(*OSD_ThreadPool::DefaultPool(), threads);
+         launcher.Perform(0, count, [&body](int, int i) { body(i); });
+         return;
+      }
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+      for (int i = 0; i < count; ++i)
+         body(i);
+   }
+
+   // The IGES controller, Interface_Static and the XSControl session of OCCT are process wide
+   // and not thread safe. Every IGES read and write holds this lock, so jobs running side by
+   // side only overlap in their healing and booleans
+   static std::mutex& ExchangeMutex() { return exchangeMutex; }
+
+   private:
+   static inline std::mutex mutex;
+   static inline std::mutex exchangeMutex;
+   static inline ConcurrencyOptions current;
+   static inline std::atomic<int> jobThreads{ 0 };
+   static inline std::atomic<bool> sharedPool{ false };
+};
@@ -0,0 +1,207 @@
+﻿#define NOMINMAX // Disable the min/max macros
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "./../OcctHeaders.h"
+
+#include "Concurrency.h"
+#include "FeatureRecognizer.h"
+
+namespace {
+   // Face frame in world axes: u along the face, v across it. Web and flange faces are axis aligned
+   struct FaceFrame {
+      FeaturePlane plane;
+      gp_Dir normal;
+      int u, v; // Coordinate index of the axes, 0 X, 1 Y, 2 Z
+   };
+
+   FaceFrame Classify(const gp_Dir& normal, const gp_Pnt& centroid, double partCentreY, double angularTolerance) {
+      double cosine = std::cos(angularTolerance);
+      if (std::abs(normal.Z()) >= cosine)
+         return { FeaturePlane::Top, normal, 0, 1 };
+      if (std::abs(normal.Y()) >= cosine)
+         return { centroid.Y() >= partCentreY ? FeaturePlane::YPos : FeaturePlane::YNeg, normal, 0, 2 };
+      // End faces and sloped faces, boxed in Y and Z
+      return { FeaturePlane::Flex, normal, std::abs(normal.X()) >= cosine ? 1 : 0, 2 };
+   }
+
+   FeatureRecord MakeRecord(FeatureKind kind, const FaceFrame& frame, int face, const gp_Pnt& centre,
+      double size1, double size2) {
+      return { (int)kind, (int)frame.plane, face, 0, centre.X(), centre.Y(), centre.Z(),
+         frame.normal.X(), frame.normal.Y(), frame.normal.Z(), size1, size2 };
+   }
+
+   gp_Pnt BoxCentre(const Bnd_Box& box, double size[3]) {
+      double xmin, ymin, zmin, xmax, ymax, zmax;
+      box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+      size[0] = xmax - xmin;
+      size[1] = ymax - ymin;
+      size[2] = zmax - zmin;
+      return gp_Pnt((xmin + xmax) / 2, (ymin + ymax) / 2, (zmin + zmax) / 2);
+   }
+
+   // A loop of circles about one centre is a hole, two equal arcs joined by lines a slot,
+   // anything else a cut-out
+   FeatureRecord ClassifyInnerLoop(const TopoDS_Wire& wire, const FaceFrame& frame, int face, double tolerance) {
+      std::vector<gp_Circ> arcs;
+      int lines = 0, others = 0;
+      Bnd_Box box;
+      for (TopExp_Explorer edgeExp(wire, TopAbs_EDGE); edgeExp.More(); edgeExp.Next()) {
+         BRepAdaptor_Curve curve(TopoDS::Edge(edgeExp.Current()));
+         BRepBndLib::AddOptimal(edgeExp.Current(), box, Standard_False, Standard_False);
+         if (curve.GetType() == GeomAbs_Circle)
+            arcs.push_back(curve.Circle());
+         else if (curve.GetType() == GeomAbs_Line)
+            lines++;
+         else
+            others++;
+      }
+
+      if (!arcs.empty() && lines == 0 && others == 0) {
+         bool round = std::all_of(arcs.begin(), arcs.end(), [&](const gp_Circ& arc) {
+            return arc.Location().Distance(arcs[0].Location()) < tolerance
+               && std::abs(arc.Radius() - arcs[0].Radius()) < tolerance;
+         });
+         if (round)
+            return MakeRecord(FeatureKind::Hole, frame, face, arcs[0].Location(), 2 * arcs[0].Radius(), 0);
+      }
+      if (arcs.size() == 2 && lines == 2 && others == 0 && std::abs(arcs[0].Radius() - arcs[1].Radius()) < tolerance) {
+         gp_Pnt centre((arcs[0].Location().XYZ() + arcs[1].Location().XYZ()) / 2);
+         double width = 2 * arcs[0].Radius();
+         return MakeRecord(FeatureKind::Slot, frame, face, centre,
+            arcs[0].Location().Distance(arcs[1].Location()) + width, width);
+      }
+
+      double size[3];
+      gp_Pnt centre = BoxCentre(box, size);
+      return MakeRecord(FeatureKind::CutOut, frame, face, centre, size[frame.u], size[frame.v]);
+   }
+
+   // Runs of outer loop edges off the sides of the face's box are notches
+   void FindNotches(const TopoDS_Face& face, const FaceFrame& frame, int faceIndex, double tolerance,
+      std::vector<FeatureRecord>& rFeatures) {
+      TopoDS_Wire outer = BRepTools::OuterWire(face);
+      if (outer.IsNull())
+         return;
+      // Tight boxes, the tolerances of healed edges would blur the sides
+      Bnd_Box faceBox;
+      BRepBndLib::AddOptimal(outer, faceBox, Standard_False, Standard_False);
+      double faceMin[3], faceMax[3];
+      faceBox.Get(faceMin[0], faceMin[1], faceMin[2], faceMax[0], faceMax[1], faceMax[2]);
+
+      std::vector<Bnd_Box> edgeBoxes;
+      std::vector<bool> onSide;
+      for (BRepTools_WireExplorer edgeExp(outer, face); edgeExp.More(); edgeExp.Next()) {
+         Bnd_Box box;
+         BRepBndLib::AddOptimal(edgeExp.Current(), box, Standard_False, Standard_False);
+         double min[3], max[3];
+         box.Get(min[0], min[1], min[2], max[0], max[1], max[2]);
+         bool side = false;
+         for (int axis : { frame.u, frame.v }) {
+            side = side || max[axis] - faceMin[axis] < 2 * tolerance || faceMax[axis] - min[axis] < 2 * tolerance;
+         }
+         edgeBoxes.push_back(box);
+         onSide.push_back(side);
+      }
+
+      // Start after an edge on a side so that no run wraps around the end of the loop
+      int count = (int)onSide.size();
+      int start = (int)(std::find(onSide.begin(), onSide.end(), true) - onSide.begin());
+      if (start == count)
+         return;
+      Bnd_Box run;
+      for (int k = 1; k <= count; k++) {
+         int i = (start + k) % count;
+         if (!onSide[i]) {
+            run.Add(edgeBoxes[i]);
+            continue;
+         }
+         if (!run.IsVoid()) {
+            double size[3];
+            gp_Pnt centre = BoxCentre(run, size);
+            rFeatures.push_back(MakeRecord(FeatureKind::Notch, frame, faceIndex, centre, size[frame.u], size[frame.v]));
+            run.SetVoid();
+         }
+      }
+   }
+
+   void RecognizeFace(const TopoDS_Face& face, int faceIndex, double partCentreY, const FeatureOptions& options,
+      std::vector<FeatureRecord>& rFeatures) {
+      BRepAdaptor_Surface surface(face, Standard_False);
+      if (surface.GetType() != GeomAbs_Plane)
+         return;
+      gp_Dir normal = surface.Plane().Axis().Direction();
+      if (face.Orientation() == TopAbs_REVERSED)
+         normal.Reverse();
+      GProp_GProps props;
+      BRepGProp::SurfaceProperties(face, props);
+      FaceFrame frame = Classify(normal, props.CentreOfMass(), partCentreY, options.angularTolerance);
+      rFeatures.push_back(MakeRecord(FeatureKind::Face, frame, faceIndex, props.CentreOfMass(), props.Mass(), 0));
+
+      TopoDS_Wire outer = BRepTools::OuterWire(face);
+      for (TopoDS_Iterator wireIt(face); wireIt.More(); wireIt.Next()) {
+         if (wireIt.Value().ShapeType() == TopAbs_WIRE && !wireIt.Value().IsSame(outer))
+            rFeatures.push_back(ClassifyInnerLoop(TopoDS::Wire(wireIt.Value()), frame, faceIndex, options.tolerance));
+      }
+      if (frame.plane != FeaturePlane::Flex)
+         FindNotches(face, frame, faceIndex, options.tolerance, rFeatures);
+   }
+
+   // The same feature seen on the other face of the plate: same kind and size, on a parallel
+   // face, offset along the normal only
+   bool IsSameFeature(const FeatureRecord& a, const FeatureRecord& b, const FeatureOptions& options) {
+      if (a.kind != b.kind || a.kind == (int)FeatureKind::Face || a.plane != b.plane
+         || std::abs(a.size1 - b.size1) > options.tolerance || std::abs(a.size2 - b.size2) > options.tolerance)
+         return false;
+      gp_Vec offset(gp_Pnt(a.x, a.y, a.z), gp_Pnt(b.x, b.y, b.z));
+      gp_Dir normal(a.nx, a.ny, a.nz);
+      double along = offset.Dot(gp_Vec(normal));
+      double across = std::sqrt(std::max(0.0, offset.SquareMagnitude() - along * along));
+      return std::abs(normal.Dot(gp_Dir(b.nx, b.ny, b.nz))) > std::cos(options.angularTolerance)
+         && across < options.tolerance && std::abs(along) < options.maxThickness;
+   }
+}
+
+std::vector<FeatureRecord> RecognizeFeatures(const TopoDS_Shape& shape, const FeatureOptions& options,
+   int& rFailedFaces) {
+   rFailedFaces = 0;
+   Bnd_Box box;
+   BRepBndLib::Add(shape, box);
+   if (box.IsVoid())
+      return {};
+   double xmin, ymin, zmin, xmax, ymax, zmax;
+   box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+
+   TopTools_IndexedMapOfShape faces;
+   TopExp::MapShapes(shape, TopAbs_FACE, faces);
+   std::vector<std::vector<FeatureRecord>> faceFeatures(faces.Extent());
+   std::atomic<int> failed{ 0 };
+   Concurrency::For(faces.Extent(), [&](int i) {
+      try {
+         RecognizeFace(TopoDS::Face(faces(i + 1)), i + 1, (ymin + ymax) / 2, options, faceFeatures[i]);
+      }
+      catch (const Standard_Failure& ex) {
+         std::cerr << "Feature recognition of face " << i + 1 << " failed: " << ex.GetMessageString() << std::endl;
+         faceFeatures[i].clear();
+         ++failed;
+      }
+   });
+   rFailedFaces = failed;
+
+   // In face order; the first face that shows a hole keeps it
+   std::vector<FeatureRecord> features;
+   for (const auto& found : faceFeatures) {
+      for (const FeatureRecord& feature : found) {
+         bool seen = std::any_of(features.begin(), features.end(),
+            [&](const FeatureRecord& kept) { return IsSameFeature(kept, feature, options); });
+         if (!seen)
+            features.push_back(feature);
+      }
+   }
+   return features;
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <vector>
+
+class TopoDS_Shape;
+
+// Features of a rail for the tooling pipeline, read off the B-rep the engine holds, so that
+// tooling can start without loading the part again. The rail runs along X with its web normal
+// to Z and its flanges normal to Y, as FChassis.Core expects
+enum class FeatureKind { Face = 0, Hole = 1, Slot = 2, Notch = 3, CutOut = 4 };
+
+// Where a feature sits, in the order of Utils.EPlane. Both faces of a flange count as the
+// flange on their side of the part, whichever way they face
+enum class FeaturePlane { YNeg = 0, YPos = 1, Top = 2, Flex = 3 };
+
+struct FeatureOptions {
+   double angularTolerance = 0.05; // Radians off an axis still counted as web or flange
+   double tolerance = 0.01;        // Of the centres, radii and boundaries compared, mm
+   double maxThickness = 25;       // Parallel faces further apart do not share their holes
+};
+
+// One row of the feature table. Fixed layout, so that managed code reads the table in place:
+// four ints then eight doubles, 80 bytes
+struct FeatureRecord {
+   int kind;          // FeatureKind
+   int plane;         // FeaturePlane
+   int face;          // Index of the face in TopExp::MapShapes order, from 1
+   int reserved;
+   double x, y, z;    // Centre of the hole, the slot, the box of a notch or cut-out, or of the face
+   double nx, ny, nz; // Outward normal of the face
+   double size1;      // Diameter of a hole, length of a slot, extent along X (Y on end faces) of the rest, area of a face
+   double size2;      // Width of a slot, extent across of a notch or cut-out, 0 otherwise
+};
+static_assert(sizeof(FeatureRecord) == 80, "The managed readers expect 80 byte rows");
+
+// A Face row for every planar face, classified by its normal, followed by the features found
+// on its loops: holes and slots on the inner loops, cut-outs for the other inner loops and
+// notches where the outer loop of a web or flange face leaves its bounding box. The faces are
+// spread over the job threads. Holes seen through both faces of a plate are reported once.
+// Faces whose geometry fails are left out of the table and counted in rFailedFaces
+std::vector<FeatureRecord> RecognizeFeatures(const TopoDS_Shape& shape, const FeatureOptions& options,
+   int& rFailedFaces);
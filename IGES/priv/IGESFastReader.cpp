@@ -0,0 +1,401 @@
+﻿#define NOMINMAX // Disable the min/max macros
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "./../OcctHeaders.h"
+
+#include "Concurrency.h"
+#include "IGESFastReader.h"
+
+namespace {
+   const std::size_t RecordWidth = 80;          // Fixed IGES records, without the line end
+   const std::uint64_t IndexChunk = 8ull << 20; // Bytes scanned by one task of the line index
+   const int EntityChunk = 1024;                // Entities tokenized by one task
+
+   // Read only view of the whole file. Views above 4 GB need the 64-bit process
+   class MappedFile {
+      public:
+      explicit MappedFile(const std::string& filePath) {
+         file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+         if (file == INVALID_HANDLE_VALUE)
+            return;
+         LARGE_INTEGER fileSize;
+         if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+         mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+         if (!mapping)
+            return;
+         data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+         if (data)
+            size = (std::uint64_t)fileSize.QuadPart;
+      }
+
+      ~MappedFile() {
+         if (data)
+            UnmapViewOfFile(data);
+         if (mapping)
+            CloseHandle(mapping);
+         if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+      }
+
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      const char* data = nullptr;
+      std::uint64_t size = 0;
+
+      private:
+      HANDLE file = INVALID_HANDLE_VALUE;
+      HANDLE mapping = nullptr;
+   };
+
+   // One line of the file: offset of its first column and its length without the line end
+   struct Record {
+      std::uint64_t offset;
+      std::uint32_t length;
+   };
+
+   // Index every line. Each task collects the line ends of its chunk, the chunks are then
+   // joined in order. Files without line ends are read as a run of 80 column records
+   bool IndexRecords(const MappedFile& file, std::vector<Record>& rRecords) {
+      std::uint64_t chunks = (file.size + IndexChunk - 1) / IndexChunk;
+      std::vector<std::vector<std::uint64_t>> ends((std::size_t)chunks);
+      Concurrency::For((int)chunks, [&](int c) {
+         std::uint64_t begin = c * IndexChunk, end = std::min(file.size, begin + IndexChunk);
+         for (std::uint64_t i = begin; i < end; i++)
+            if (file.data[i] == '\n')
+               ends[c].push_back(i);
+      });
+
+      std::size_t lineEnds = 0;
+      for (const auto& chunk : ends)
+         lineEnds += chunk.size();
+
+      rRecords.clear();
+      if (lineEnds == 0) {
+         if (file.size % RecordWidth != 0)
+            return false;
+         rRecords.reserve((std::size_t)(file.size / RecordWidth));
+         for (std::uint64_t offset = 0; offset < file.size; offset += RecordWidth)
+            rRecords.push_back({ offset, (std::uint32_t)RecordWidth });
+         return true;
+      }
+
+      rRecords.reserve(lineEnds + 1);
+      std::uint64_t start = 0;
+      auto addRecord = [&](std::uint64_t end) {
+         std::uint64_t length = end - start;
+         if (length > 0 && file.data[end - 1] == '\r')
+            length--;
+         if (length > 0)
+            rRecords.push_back({ start, (std::uint32_t)std::min<std::uint64_t>(length, RecordWidth) });
+      };
+      for (const auto& chunk : ends)
+         for (std::uint64_t end : chunk) {
+            addRecord(end);
+            start = end + 1;
+         }
+      if (start < file.size)
+         addRecord(file.size);
+      return true;
+   }
+
+   // Columns [column, column + width) of a record, 1 based as in the IGES specification
+   std::string_view Field(const MappedFile& file, const Record& record, std::size_t column, std::size_t width) {
+      std::size_t first = column - 1;
+      if (first >= record.length)
+         return {};
+      return std::string_view(file.data + record.offset + first, std::min<std::size_t>(width, record.length - first));
+   }
+
+   std::string_view Trim(std::string_view text) {
+      while (!text.empty() && text.front() == ' ')
+         text.remove_prefix(1);
+      while (!text.empty() && text.back() == ' ')
+         text.remove_suffix(1);
+      return text;
+   }
+
+   // Integer field of a Directory Entry. Blank fields are 0
+   bool ParseInt(std::string_view text, int& rValue) {
+      text = Trim(text);
+      rValue = 0;
+      if (text.empty())
+         return true;
+      bool negative = text.front() == '-';
+      if (text.front() == '-' || text.front() == '+')
+         text.remove_prefix(1);
+      if (text.empty())
+         return false;
+      for (char c : text) {
+         if (c < '0' || c > '9')
+            return false;
+         rValue = rValue * 10 + (c - '0');
+      }
+      if (negative)
+         rValue = -rValue;
+      return true;
+   }
+
+   bool IsInteger(std::string_view text) {
+      if (!text.empty() && (text.front() == '-' || text.front() == '+'))
+         text.remove_prefix(1);
+      return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+   }
+
+   // [sign] digits [. digits] [E|D [sign] digits], with at least one mantissa digit
+   bool IsReal(std::string_view text) {
+      std::size_t i = 0, n = text.size(), digits = 0;
+      if (i < n && (text[i] == '-' || text[i] == '+'))
+         i++;
+      for (; i < n && text[i] >= '0' && text[i] <= '9'; i++)
+         digits++;
+      if (i < n && text[i] == '.')
+         for (i++; i < n && text[i] >= '0' && text[i] <= '9'; i++)
+            digits++;
+      if (digits == 0)
+         return false;
+      if (i < n && (text[i] == 'E' || text[i] == 'e' || text[i] == 'D' || text[i] == 'd')) {
+         i++;
+         if (i < n && (text[i] == '-' || text[i] == '+'))
+            i++;
+         std::size_t exponent = i;
+         for (; i < n && text[i] >= '0' && text[i] <= '9'; i++);
+         if (i == exponent)
+            return false;
+      }
+      return i == n;
+   }
+
+   // Parameters of one record, kept as null separated text for AddParam
+   struct ParamList {
+      std::string text;
+      std::vector<std::pair<std::uint32_t, Interface_ParamType>> params;
+
+      void Add(std::string_view value, Interface_ParamType type) {
+         params.emplace_back((std::uint32_t)text.size(), type);
+         text.append(value.data(), value.size());
+         text.push_back('\0');
+      }
+
+      const char* Value(std::size_t i) const {
+         return text.c_str() + params[i].first;
+      }
+   };
+
+   // Split free format parameters up to the record delimiter. Hollerith strings keep
+   // their nH prefix, as the OCCT tokenizer hands them to the reader data
+   void Tokenize(std::string_view text, char paramDelimiter, char recordDelimiter, ParamList& rList) {
+      std::size_t pos = 0, n = text.size();
+      while (pos < n) {
+         while (pos < n && text[pos] == ' ')
+            pos++;
+         std::size_t start = pos, digits = pos;
+         while (digits < n && text[digits] >= '0' && text[digits] <= '9')
+            digits++;
+
+         std::string_view value;
+         Interface_ParamType type;
+         if (digits > start && digits < n && text[digits] == 'H') {
+            int count = 0;
+            ParseInt(text.substr(start, digits - start), count);
+            pos = std::min(n, digits + 1 + (std::size_t)count);
+            value = text.substr(start, pos - start);
+            type = Interface_ParamText;
+            while (pos < n && text[pos] != paramDelimiter && text[pos] != recordDelimiter)
+               pos++;
+         }
+         else {
+            while (pos < n && text[pos] != paramDelimiter && text[pos] != recordDelimiter)
+               pos++;
+            value = Trim(text.substr(start, pos - start));
+            if (value.empty())
+               type = Interface_ParamVoid;
+            else if (IsInteger(value))
+               type = Interface_ParamInteger;
+            else if (IsReal(value))
+               type = Interface_ParamReal;
+            else
+               type = Interface_ParamMisc;
+         }
+
+         if (type == Interface_ParamReal && value.find_first_of("Dd") != std::string_view::npos) {
+            std::string real(value);
+            std::replace(real.begin(), real.end(), 'D', 'E');
+            std::replace(real.begin(), real.end(), 'd', 'e');
+            rList.Add(real, type);
+         }
+         else
+            rList.Add(value, type);
+
+         if (pos >= n || text[pos++] == recordDelimiter)
+            return;
+      }
+   }
+
+   // Delimiters of the Global section: its first two parameters, 1H, and 1H; when
+   // not defaulted
+   std::size_t ReadDelimiter(std::string_view text, std::size_t pos, char defaultDelimiter,
+      char& rDelimiter, ParamList& rList) {
+      while (pos < text.size() && text[pos] == ' ')
+         pos++;
+      if (text.substr(pos, 2) == "1H" && pos + 2 < text.size()) {
+         rDelimiter = text[pos + 2];
+         rList.Add(text.substr(pos, 3), Interface_ParamText);
+         return pos + 3;
+      }
+      rDelimiter = defaultDelimiter;
+      rList.Add({}, Interface_ParamVoid);
+      return pos;
+   }
+
+   struct DirEntry {
+      int values[17] = {};
+      std::string res1, res2, label, subscript;
+   };
+}
+
+bool ReadIGESFast(const std::string& filePath, IGESControl_Reader& reader) {
+   MappedFile file(filePath);
+   if (!file.data)
+      return false;
+
+   std::vector<Record> records;
+   if (!IndexRecords(file, records))
+      return false;
+
+   // The sections follow each other in the order S, G, D, P, T
+   const std::string order = "SGDPT";
+   std::size_t begin[5] = {}, count[5] = {};
+   int section = 0;
+   for (std::size_t i = 0; i < records.size(); i++) {
+      if (records[i].length < 73)
+         return false;
+      std::size_t letter = order.find(file.data[records[i].offset + 72]);
+      if (letter == std::string::npos || (int)letter < section)
+         return false;
+      if ((int)letter > section || count[letter] == 0) {
+         section = (int)letter;
+         begin[letter] = i;
+      }
+      count[letter]++;
+   }
+   const std::size_t S = 0, G = 1, D = 2, P = 3;
+   if (count[D] == 0 || count[D] % 2 != 0 || count[P] == 0)
+      return false;
+
+   // Global section, free format over columns 1 to 72
+   std::string global;
+   for (std::size_t i = 0; i < count[G]; i++)
+      global.append(Field(file, records[begin[G] + i], 1, 72));
+   ParamList globalParams;
+   char paramDelimiter = ',', recordDelimiter = ';';
+   std::size_t pos = ReadDelimiter(global, 0, ',', paramDelimiter, globalParams);
+   if (pos < global.size() && global[pos] == paramDelimiter)
+      pos = ReadDelimiter(global, pos + 1, ';', recordDelimiter, globalParams);
+   if (pos < global.size() && global[pos] == paramDelimiter)
+      Tokenize(std::string_view(global).substr(pos + 1), paramDelimiter, recordDelimiter, globalParams);
+
+   // Directory Entries, two records each, parsed in parallel
+   int entityCount = (int)(count[D] / 2);
+   std::vector<DirEntry> entries(entityCount);
+   std::atomic<bool> valid{ true };
+   Concurrency::For((entityCount + EntityChunk - 1) / EntityChunk, [&](int chunk) {
+      int last = std::min(entityCount, (chunk + 1) * EntityChunk);
+      for (int e = chunk * EntityChunk; e < last; e++) {
+         const Record& first = records[begin[D] + 2 * e];
+         const Record& second = records[begin[D] + 2 * e + 1];
+         DirEntry& entry = entries[e];
+         bool ok = true;
+         for (int f = 0; f < 8; f++)
+            ok &= ParseInt(Field(file, first, 1 + 8 * f, 8), entry.values[f]);
+         std::string_view status = Field(file, first, 65, 8);
+         for (int f = 0; f < 4; f++)
+            ok &= ParseInt(status.substr(std::min<std::size_t>(status.size(), 2 * f), 2), entry.values[8 + f]);
+         for (int f = 0; f < 5; f++)
+            ok &= ParseInt(Field(file, second, 1 + 8 * f, 8), entry.values[12 + f]);
+         entry.res1 = Field(file, second, 41, 8);
+         entry.res2 = Field(file, second, 49, 8);
+         entry.label = Field(file, second, 57, 8);
+         entry.subscript = Field(file, second, 65, 8);
+         if (!ok)
+            valid = false;
+      }
+   });
+   if (!valid)
+      return false;
+
+   // Parameter Data of each entity: columns 1 to 64 of its records, joined then tokenized
+   std::vector<ParamList> params(entityCount);
+   Concurrency::For((entityCount + EntityChunk - 1) / EntityChunk, [&](int chunk) {
+      int last = std::min(entityCount, (chunk + 1) * EntityChunk);
+      std::string text;
+      for (int e = chunk * EntityChunk; e < last; e++) {
+         std::int64_t first = entries[e].values[1], lines = entries[e].values[15];
+         if (first < 1 || lines < 1 || first - 1 + lines > (std::int64_t)count[P]) {
+            valid = false;
+            continue;
+         }
+         text.clear();
+         for (std::int64_t line = 0; line < lines; line++)
+            text.append(Field(file, records[begin[P] + first - 1 + line], 1, 64));
+         Tokenize(text, paramDelimiter, recordDelimiter, params[e]);
+      }
+   });
+   if (!valid)
+      return false;
+
+   Handle(IGESData_Protocol) protocol = Handle(IGESData_Protocol)::DownCast(reader.WS()->Protocol());
+   if (protocol.IsNull())
+      return false;
+
+   // Fill the reader data in order, then let OCCT build the entities of the model
+   try {
+      std::size_t paramCount = 0;
+      for (const auto& list : params)
+         paramCount += list.params.size();
+      Handle(IGESData_IGESReaderData) data = new IGESData_IGESReaderData(entityCount, (Standard_Integer)paramCount);
+
+      for (std::size_t i = 0; i < count[S]; i++)
+         data->AddStartLine(std::string(Field(file, records[begin[S] + i], 1, 72)).c_str());
+      for (std::size_t i = 0; i < globalParams.params.size(); i++)
+         data->AddGlobal(globalParams.params[i].second, globalParams.Value(i));
+      data->SetGlobalSection();
+
+      for (int e = 0; e < entityCount; e++) {
+         const int* v = entries[e].values;
+         data->SetDirPart(e + 1, v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9], v[10],
+            v[11], v[12], v[13], v[14], v[15], v[16], entries[e].res1.c_str(), entries[e].res2.c_str(),
+            entries[e].label.c_str(), entries[e].subscript.c_str());
+         const ParamList& list = params[e];
+         for (std::size_t i = 0; i < list.params.size(); i++)
+            data->AddParam(e + 1, list.Value(i), list.params[i].second);
+         params[e] = ParamList(); // Release the text as the reader data takes it over
+      }
+
+      Handle(IGESData_IGESModel) model = new IGESData_IGESModel;
+      IGESData_IGESReaderTool tool(data, protocol);
+      tool.Prepare(Handle(IGESData_FileRecognizer)());
+      tool.SetErrorHandle(Standard_True);
+      tool.LoadModel(model);
+      if (model->Protocol().IsNull())
+         model->SetProtocol(protocol);
+
+      reader.WS()->SetModel(model);
+      reader.WS()->SetLoadedFile(filePath.c_str());
+      reader.WS()->InitTransferReader(4);
+   }
+   catch (const Standard_Failure&) {
+      return false;
+   }
+   return true;
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+#include <string>
+
+class IGESControl_Reader;
+
+// Front end of the IGES import for large files. The file is mapped rather than read,
+// the Directory Entry and Parameter Data records are tokenized in parallel chunks and
+// the IGESData_IGESModel is filled in one pass, as IGESControl_Reader::ReadFile would.
+// The reader is then ready for TransferRoots.
+//
+// Returns false, with the reader untouched, when the file is not a plain fixed format
+// IGES file this front end understands. The caller then falls back to ReadFile
+bool ReadIGESFast(const std::string& filePath, IGESControl_Reader& reader);
@@ -2,12 +2,36 @@
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <map>
+#include <memory_resource>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <omp.h>
+#include <sstream>
 
 #include "./../OcctHeaders.h"
 
 #include "IGESNative.h"
+#include "Concurrency.h"
+#include "IGESFastReader.h"
+#include "FeatureRecognizer.h"
+#include "JoinCache.h"
+#include "Projection.h"
+#include "RailGenerator.h"
+#include "Slicer.h"
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+
 extern "C" void CleanupOCCT() {
    try {
       // Properly unload Tcl/Tk resources before exiting
@@ -23,6 +47,126 @@ struct SurfaceInfo {
    double width;  // Shortest dimension
 };
 
+struct FaceBox {
+   TopoDS_Face face;
+   Bnd_Box box;
+};
+
+// A part ready for its slot: the healed shape, its join cache key and the bytes its shared
+// geometry saved
+struct LoadedPart {
+   TopoDS_Shape shape;
+   std::string key;
+   std::size_t sharedBytes = 0;
+};
+
+// One configuration tried by the speculative fuse
+struct FuseStrategy {
+   const char* name;
+   double fuzzyValue;    // 0 for an exact fuse
+   BOPAlgo_GlueEnum glue;
+   bool healInputs;      // Fuse healed copies of the inputs
+};
+
+// Progress indicator that reports a user break once the shared flag is raised,
+// used to cancel boolean operations running on other threads
+class CancelIndicator : public Message_ProgressIndicator {
+   public:
+   explicit CancelIndicator(const std::atomic<bool>& cancelled) : cancelled(cancelled) {}
+
+   Standard_Boolean UserBreak() override {
+      return cancelled.load();
+   }
+
+   void Show(const Message_ProgressScope&, const Standard_Boolean) override {}
+
+   private:
+   const std::atomic<bool>& cancelled;
+};
+
+// Progress indicator that reports a user break once its deadline has passed, used to stop
+// the stages of a budgeted join on time
+class DeadlineIndicator : public Message_ProgressIndicator {
+   public:
+   explicit DeadlineIndicator(std::chrono::steady_clock::time_point deadline) : deadline(deadline) {}
+
+   Standard_Boolean UserBreak() override {
+      return std::chrono::steady_clock::now() >= deadline;
+   }
+
+   void Show(const Message_ProgressScope&, const Standard_Boolean) override {}
+
+   private:
+   std::chrono::steady_clock::time_point deadline;
+};
+
+// Working set and peak working set of the process, in bytes
+static void ProcessMemory(std::size_t& rWorkingSet, std::size_t& rPeakWorkingSet) {
+   PROCESS_MEMORY_COUNTERS counters{};
+   if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      rWorkingSet = rPeakWorkingSet = 0;
+      return;
+   }
+   rWorkingSet = counters.WorkingSetSize;
+   rPeakWorkingSet = counters.PeakWorkingSetSize;
+}
+
+// Measures the process memory over one command and files it in the engine's report
+class OperationMemoryScope {
+   public:
+   OperationMemoryScope(MemoryReport& report, const char* operation) : report(report), operation(operation) {
+      std::size_t peak;
+      ProcessMemory(this->startWorkingSet, peak);
+   }
+
+   ~OperationMemoryScope() {
+      std::size_t workingSet, peak;
+      ProcessMemory(workingSet, peak);
+      this->report.lastOperation = this->operation;
+      this->report.operationDelta = (long long)workingSet - (long long)this->startWorkingSet;
+      this->report.operationPeak = peak;
+   }
+
+   private:
+   MemoryReport& report;
+   const char* operation;
+   std::size_t startWorkingSet = 0;
+};
+
+// Scoped arena of one join. The pave fillers of the booleans draw from one incremental
+// allocator, and the engine's scratch collections from a monotonic buffer. Both are released
+// in one step with the arena instead of millions of small frees into the global heap. The
+// result shapes and the history never come from the arena. Declare the arena before the
+// fusers that use its fillers, so that they go first
+class JobArena {
+   public:
+   static constexpr std::size_t BlockSize = 1 << 20;
+
+   JobArena() : allocator(new NCollection_IncAllocator(BlockSize)) {
+      this->allocator->SetThreadSafe(true); // The boolean runs parallel
+   }
+
+   ~JobArena() {
+      this->fillers.clear();
+      this->allocator.Nullify();
+      Standard::Purge();
+   }
+
+   BOPAlgo_PaveFiller& NewFiller() {
+      this->fillers.push_back(std::make_unique<BOPAlgo_PaveFiller>(this->allocator));
+      return *this->fillers.back();
+   }
+
+   std::pmr::memory_resource* Scratch() {
+      return &this->scratch;
+   }
+
+   private:
+   Handle(NCollection_IncAllocator) allocator;
+   std::vector<std::unique_ptr<BOPAlgo_PaveFiller>> fillers;
+   std::pmr::monotonic_buffer_resource scratch;
+};
+
 class OCCTUtils {
    public:
 
@@ -31,12 +175,124 @@ class OCCTUtils {
       return copier.Shape();
    }
 
-   static TopoDS_Shape FixShape(const TopoDS_Shape& shape) {
+   // Range of one step of a long operation, under the indicator when there is one
+   static Message_ProgressRange StepRange(const Handle(Message_ProgressIndicator)& indicator) {
+      return indicator.IsNull() ? Message_ProgressRange() : indicator->Start();
+   }
+
+   static TopoDS_Shape FixShape(const TopoDS_Shape& shape,
+      const Handle(Message_ProgressIndicator)& indicator = Handle(Message_ProgressIndicator)()) {
+      Handle(ShapeFix_Shape) fixer = new ShapeFix_Shape(shape);
+      fixer->Perform(StepRange(indicator));
+      return fixer->Shape();
+   }
+
+   // Heal the shape and follow the tracked faces through the healing
+   static TopoDS_Shape FixShape(const TopoDS_Shape& shape, TopTools_IndexedMapOfShape& rTrackedFaces,
+      const Handle(Message_ProgressIndicator)& indicator = Handle(Message_ProgressIndicator)()) {
       Handle(ShapeFix_Shape) fixer = new ShapeFix_Shape(shape);
-      fixer->Perform();
+      fixer->Perform(StepRange(indicator));
+
+      TopTools_IndexedMapOfShape trackedFaces;
+      for (int i = 1; i <= rTrackedFaces.Extent(); ++i) {
+         TopoDS_Shape healed = fixer->Context()->Apply(rTrackedFaces(i));
+         for (TopExp_Explorer faceExp(healed, TopAbs_FACE); faceExp.More(); faceExp.Next())
+            trackedFaces.Add(faceExp.Current());
+      }
+      rTrackedFaces = trackedFaces;
       return fixer->Shape();
    }
 
+   // Heal only what the analyzer reports. The faulty faces are fixed in parallel and spliced
+   // back; a valid shape is returned as is. ShapeFix updates edges and vertices in place, so
+   // the faces fixed together share neither. Falls back to the full FixShape when the fault
+   // is above the faces or the splice does not come out valid
+   static TopoDS_Shape FixShapeTargeted(const TopoDS_Shape& shape, TopTools_IndexedMapOfShape* pTrackedFaces = nullptr) {
+      auto fixAll = [&]() {
+         return pTrackedFaces ? FixShape(shape, *pTrackedFaces) : FixShape(shape);
+      };
+      BRepCheck_Analyzer analyzer(shape, Standard_True, Standard_True);
+      if (analyzer.IsValid())
+         return shape;
+
+      TopTools_IndexedMapOfShape faces;
+      TopExp::MapShapes(shape, TopAbs_FACE, faces);
+      std::vector<TopoDS_Face> badFaces;
+      for (int i = 1; i <= faces.Extent(); ++i) {
+         if (!analyzer.IsValid(faces(i)))
+            badFaces.push_back(TopoDS::Face(faces(i)));
+      }
+      if (badFaces.empty())
+         return fixAll();
+
+      // Batches of faces with no edge or vertex in common
+      std::vector<std::vector<int>> batches;
+      std::vector<TopTools_MapOfShape> batchShapes;
+      for (int f = 0; f < (int)badFaces.size(); f++) {
+         TopTools_IndexedMapOfShape subShapes;
+         TopExp::MapShapes(badFaces[f], TopAbs_EDGE, subShapes);
+         TopExp::MapShapes(badFaces[f], TopAbs_VERTEX, subShapes);
+         std::size_t b = 0;
+         for (; b < batches.size(); b++) {
+            bool shared = false;
+            for (int i = 1; i <= subShapes.Extent() && !shared; ++i)
+               shared = batchShapes[b].Contains(subShapes(i));
+            if (!shared)
+               break;
+         }
+         if (b == batches.size()) {
+            batches.emplace_back();
+            batchShapes.emplace_back();
+         }
+         batches[b].push_back(f);
+         for (int i = 1; i <= subShapes.Extent(); ++i)
+            batchShapes[b].Add(subShapes(i));
+      }
+
+      // Each face records its own replacements, merged into one context for the splice
+      std::vector<Handle(ShapeBuild_ReShape)> faceContexts(badFaces.size());
+      std::vector<TopoDS_Shape> fixedFaces(badFaces.size());
+      for (const auto& batch : batches) {
+         Concurrency::For((int)batch.size(), [&](int k) {
+            int f = batch[k];
+            faceContexts[f] = new ShapeBuild_ReShape();
+            ShapeFix_Face fixer(badFaces[f]);
+            fixer.SetContext(faceContexts[f]);
+            fixer.Perform();
+            fixedFaces[f] = fixer.Result();
+         });
+      }
+
+      Handle(ShapeBuild_ReShape) context = new ShapeBuild_ReShape();
+      for (int f = 0; f < (int)badFaces.size(); f++) {
+         TopTools_IndexedMapOfShape subShapes;
+         TopExp::MapShapes(badFaces[f], TopAbs_EDGE, subShapes);
+         TopExp::MapShapes(badFaces[f], TopAbs_VERTEX, subShapes);
+         for (int i = 1; i <= subShapes.Extent(); ++i) {
+            if (faceContexts[f]->IsRecorded(subShapes(i)))
+               context->Replace(subShapes(i), faceContexts[f]->Value(subShapes(i)));
+         }
+         if (!fixedFaces[f].IsNull() && !fixedFaces[f].IsSame(badFaces[f]))
+            context->Replace(badFaces[f], fixedFaces[f]);
+      }
+      TopoDS_Shape healed = context->Apply(shape);
+
+      BRepCheck_Analyzer check(healed, Standard_True, Standard_True);
+      if (!check.IsValid())
+         return fixAll();
+
+      if (pTrackedFaces) {
+         TopTools_IndexedMapOfShape trackedFaces;
+         for (int i = 1; i <= pTrackedFaces->Extent(); ++i) {
+            TopoDS_Shape tracked = context->Apply((*pTrackedFaces)(i));
+            for (TopExp_Explorer faceExp(tracked, TopAbs_FACE); faceExp.More(); faceExp.Next())
+               trackedFaces.Add(faceExp.Current());
+         }
+         *pTrackedFaces = trackedFaces;
+      }
+      return healed;
+   }
+
    static bool IsShapeValid(const TopoDS_Shape& shape) {
       BRepCheck_Analyzer analyzer(shape);
       return analyzer.IsValid();
@@ -130,38 +386,873 @@ class OCCTUtils {
       return minXDist; // Returns the shortest distance along X-axis
    }
 
-   static double FindMinDistance(const std::vector<gp_Pnt>& midpoints1, const std::vector<gp_Pnt>& midpoints2) {
-      double minDistance = std::numeric_limits<double>::max();
+   // Bounding box of every face of the shape, computed in parallel
+   static std::vector<FaceBox> ComputeFaceBoxes(const TopoDS_Shape& shape) {
+      TopTools_IndexedMapOfShape faces;
+      TopExp::MapShapes(shape, TopAbs_FACE, faces);
+
+      std::vector<FaceBox> faceBoxes(faces.Extent());
+      Concurrency::For(faces.Extent(), [&](int i) {
+         faceBoxes[i].face = TopoDS::Face(faces(i + 1));
+         BRepBndLib::Add(faceBoxes[i].face, faceBoxes[i].box);
+      });
+      return faceBoxes;
+   }
+
+   // Canonical recognition: replace the spline faces and edges that are really planes,
+   // cylinders, cones, lines, circles.. by analytic geometry. The fitting runs per face and
+   // per edge in parallel; the results are spliced back and the pcurves rebuilt by ShapeFix
+   static TopoDS_Shape CanonicalizeGeometry(const TopoDS_Shape& shape, double tolerance) {
+      TopTools_IndexedMapOfShape faces, edges;
+      TopExp::MapShapes(shape, TopAbs_FACE, faces);
+      TopExp::MapShapes(shape, TopAbs_EDGE, edges);
+
+      std::vector<Handle(Geom_Surface)> surfaces(faces.Extent());
+      std::vector<double> surfaceGaps(faces.Extent(), 0.0);
+      Concurrency::For(faces.Extent(), [&](int i) {
+         const TopoDS_Face& face = TopoDS::Face(faces(i + 1));
+         TopLoc_Location location;
+         Handle(Geom_Surface) surface = BRep_Tool::Surface(face, location);
+         if (surface.IsNull())
+            return;
+         GeomAbs_SurfaceType type = GeomAdaptor_Surface(surface).GetType();
+         if (type == GeomAbs_Plane || type == GeomAbs_Cylinder || type == GeomAbs_Cone ||
+            type == GeomAbs_Sphere || type == GeomAbs_Torus)
+            return;
+
+         try {
+            double uMin, uMax, vMin, vMax;
+            BRepTools::UVBounds(face, uMin, uMax, vMin, vMax);
+            GeomConvert_SurfToAnaSurf converter(surface);
+            Handle(Geom_Surface) analytic = converter.ConvertToAnalytical(tolerance, uMin, uMax, vMin, vMax);
+            if (analytic.IsNull())
+               return;
+
+            // The fitted surface may come out with the opposite normal; keep the face side
+            gp_Pnt point, analyticPoint;
+            gp_Vec du, dv, analyticDu, analyticDv;
+            surface->D1(0.5 * (uMin + uMax), 0.5 * (vMin + vMax), point, du, dv);
+            GeomAPI_ProjectPointOnSurf projector(point, analytic);
+            if (projector.NbPoints() == 0)
+               return;
+            double u, v;
+            projector.LowerDistanceParameters(u, v);
+            analytic->D1(u, v, analyticPoint, analyticDu, analyticDv);
+            if ((du ^ dv).Dot(analyticDu ^ analyticDv) < 0)
+               analytic = analytic->UReversed();
+
+            surfaces[i] = analytic;
+            surfaceGaps[i] = converter.Gap();
+         }
+         catch (const Standard_Failure&) {
+            // Keep the original surface
+         }
+      });
+
+      std::vector<Handle(Geom_Curve)> curves(edges.Extent());
+      std::vector<std::pair<double, double>> ranges(edges.Extent());
+      std::vector<double> curveGaps(edges.Extent(), 0.0);
+      Concurrency::For(edges.Extent(), [&](int i) {
+         const TopoDS_Edge& edge = TopoDS::Edge(edges(i + 1));
+         TopoDS_Vertex firstVertex, lastVertex;
+         TopExp::Vertices(edge, firstVertex, lastVertex);
+         // Closed edges would leave the vertex parameter ambiguous on the new curve
+         if (BRep_Tool::Degenerated(edge) || firstVertex.IsSame(lastVertex))
+            return;
+         TopLoc_Location location;
+         double first, last;
+         Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, location, first, last);
+         if (curve.IsNull())
+            return;
+         GeomAbs_CurveType type = GeomAdaptor_Curve(curve).GetType();
+         if (type == GeomAbs_Line || type == GeomAbs_Circle || type == GeomAbs_Ellipse)
+            return;
+
+         try {
+            GeomConvert_CurveToAnaCurve converter(curve);
+            Handle(Geom_Curve) analytic;
+            double newFirst, newLast;
+            if (!converter.ConvertToAnalytical(tolerance, analytic, first, last, newFirst, newLast))
+               return;
+            // Only accept a curve running the same way as the original
+            if (analytic->Value(newFirst).Distance(curve->Value(first)) > tolerance ||
+               analytic->Value(newLast).Distance(curve->Value(last)) > tolerance)
+               return;
+
+            curves[i] = analytic;
+            ranges[i] = { newFirst, newLast };
+            curveGaps[i] = converter.Gap();
+         }
+         catch (const Standard_Failure&) {
+            // Keep the original curve
+         }
+      });
+
+      TopTools_IndexedDataMapOfShapeListOfShape edgeFaces;
+      TopExp::MapShapesAndAncestors(shape, TopAbs_EDGE, TopAbs_FACE, edgeFaces);
+
+      // Faces whose pcurves must be recomputed on the new geometry
+      TopTools_IndexedMapOfShape touchedFaces;
+      Handle(ShapeBuild_ReShape) reShape = new ShapeBuild_ReShape;
+      BRep_Builder builder;
+      for (int i = 0; i < edges.Extent(); ++i) {
+         if (curves[i].IsNull())
+            continue;
+         TopoDS_Edge edge = TopoDS::Edge(edges(i + 1).Oriented(TopAbs_FORWARD));
+         TopoDS_Vertex firstVertex, lastVertex;
+         TopExp::Vertices(edge, firstVertex, lastVertex);
+         TopLoc_Location location;
+         double first, last;
+         BRep_Tool::Curve(edge, location, first, last);
+         Handle(Geom_Curve) curve = location.IsIdentity() ? curves[i] :
+            Handle(Geom_Curve)::DownCast(curves[i]->Transformed(location.Transformation()));
+
+         TopoDS_Edge newEdge;
+         builder.MakeEdge(newEdge, curve, std::max(BRep_Tool::Tolerance(edge), curveGaps[i]));
+         builder.Add(newEdge, firstVertex.Oriented(TopAbs_FORWARD));
+         builder.Add(newEdge, lastVertex.Oriented(TopAbs_REVERSED));
+         builder.Range(newEdge, ranges[i].first, ranges[i].second);
+         reShape->Replace(edge, newEdge);
+
+         for (const TopoDS_Shape& face : edgeFaces.FindFromKey(edge))
+            touchedFaces.Add(face);
+      }
 
-      // Flatten the nested loops into a single loop
-      size_t totalIterations = midpoints1.size() * midpoints2.size();
+      for (int i = 0; i < faces.Extent(); ++i) {
+         if (surfaces[i].IsNull())
+            continue;
+         TopoDS_Face face = TopoDS::Face(faces(i + 1).Oriented(TopAbs_FORWARD));
+         TopLoc_Location location;
+         BRep_Tool::Surface(face, location);
+
+         // The wires take the rebuilt edges so the new face is complete when replaced
+         TopoDS_Face newFace;
+         builder.MakeFace(newFace, surfaces[i], location, std::max(BRep_Tool::Tolerance(face), surfaceGaps[i]));
+         builder.NaturalRestriction(newFace, BRep_Tool::NaturalRestriction(face));
+         for (TopoDS_Iterator wireIt(face); wireIt.More(); wireIt.Next())
+            builder.Add(newFace, reShape->Apply(wireIt.Value()));
+         reShape->Replace(face, newFace);
+
+         touchedFaces.Add(face);
+      }
 
-#pragma omp parallel
-      {
-         // Each thread has its own local minimum
-         double localMinDistance = std::numeric_limits<double>::max();
-
-#pragma omp for
-         for (int k = 0; k < totalIterations; ++k) {
-            // Compute the indices for the original nested loops
-            int i = k / (int)midpoints2.size();
-            int j = k % midpoints2.size();
-
-            // Compute the distance
-            double distance = midpoints1[i].Distance(midpoints2[j]);
-            if (distance < localMinDistance) {
-               localMinDistance = distance;
+      if (touchedFaces.IsEmpty())
+         return shape;
+
+      TopoDS_Shape result = reShape->Apply(shape);
+      Handle(ShapeBuild_ReShape) fixContext = new ShapeBuild_ReShape;
+      for (int i = 1; i <= touchedFaces.Extent(); ++i) {
+         TopoDS_Shape rebuilt = reShape->Apply(touchedFaces(i));
+         for (TopExp_Explorer faceExp(rebuilt, TopAbs_FACE); faceExp.More(); faceExp.Next()) {
+            Handle(ShapeFix_Face) faceFixer = new ShapeFix_Face(TopoDS::Face(faceExp.Current()));
+            faceFixer->SetContext(fixContext);
+            faceFixer->SetPrecision(tolerance);
+            faceFixer->Perform();
+         }
+      }
+      return fixContext->Apply(result);
+   }
+
+   // Export compaction. The boolean leaves every split face and edge, and the pcurves of the
+   // surfaces it merged away. Splines go back to analytic form first, so that more faces
+   // turn out to share a surface, then the same-domain faces and edges are merged. The last
+   // steps change edges and vertices in place, so they work on a copy of the topology.
+   // A compacted shape that fails the check, or falls apart from one solid, is dropped
+   // and the shape is written as it was
+   static TopoDS_Shape CompactForExport(const TopoDS_Shape& shape, double tolerance, ExportReport& rReport) {
+      CountTopology(shape, rReport.faces[0], rReport.edges[0], rReport.vertices[0]);
+      rReport.shapeBytes[0] = EstimateShapeBytes(shape);
+
+      TopoDS_Shape result = CanonicalizeGeometry(shape, tolerance);
+      try {
+         ShapeUpgrade_UnifySameDomain unify(result, Standard_True, Standard_True, Standard_False);
+         unify.SetLinearTolerance(tolerance);
+         unify.Build();
+         result = unify.Shape();
+      }
+      catch (const Standard_Failure&) {
+         // Keep the faces as they are
+      }
+
+      result = BRepBuilderAPI_Copy(result, Standard_False, Standard_False).Shape();
+      result = MergeCoincidentVertices(result, tolerance);
+      BRepTools::RemoveUnusedPCurves(result);
+      if (!IsShapeValid(result) || (IsSingleSolid(shape) && !IsSingleSolid(result)))
+         return shape;
+
+      CountTopology(result, rReport.faces[1], rReport.edges[1], rReport.vertices[1]);
+      rReport.shapeBytes[1] = EstimateShapeBytes(result);
+      rReport.compacted = true;
+      return result;
+   }
+
+   static void CountTopology(const TopoDS_Shape& shape, int& rFaces, int& rEdges, int& rVertices) {
+      TopTools_IndexedMapOfShape faces, edges, vertices;
+      TopExp::MapShapes(shape, TopAbs_FACE, faces);
+      TopExp::MapShapes(shape, TopAbs_EDGE, edges);
+      TopExp::MapShapes(shape, TopAbs_VERTEX, vertices);
+      rFaces = faces.Extent();
+      rEdges = edges.Extent();
+      rVertices = vertices.Extent();
+   }
+
+   // Replace vertices lying within tolerance of another by that vertex. A sweep along X
+   // finds the candidates; the two ends of one edge are never merged
+   static TopoDS_Shape MergeCoincidentVertices(const TopoDS_Shape& shape, double tolerance) {
+      TopTools_IndexedDataMapOfShapeListOfShape vertexEdges;
+      TopExp::MapShapesAndAncestors(shape, TopAbs_VERTEX, TopAbs_EDGE, vertexEdges);
+      int count = vertexEdges.Extent();
+      std::vector<gp_Pnt> points(count);
+      std::vector<int> order(count);
+      for (int i = 0; i < count; ++i) {
+         points[i] = BRep_Tool::Pnt(TopoDS::Vertex(vertexEdges.FindKey(i + 1)));
+         order[i] = i;
+      }
+      std::sort(order.begin(), order.end(), [&](int a, int b) { return points[a].X() < points[b].X(); });
+
+      auto shareEdge = [&](int a, int b) {
+         const TopoDS_Shape& other = vertexEdges.FindKey(b + 1);
+         for (const TopoDS_Shape& edge : vertexEdges(a + 1))
+            for (TopExp_Explorer vertexExp(edge, TopAbs_VERTEX); vertexExp.More(); vertexExp.Next())
+               if (vertexExp.Current().IsSame(other))
+                  return true;
+         return false;
+      };
+
+      Handle(ShapeBuild_ReShape) reShape = new ShapeBuild_ReShape;
+      BRep_Builder builder;
+      std::vector<bool> merged(count, false);
+      int mergedCount = 0;
+      for (int k = 0; k < count; ++k) {
+         int i = order[k];
+         if (merged[i])
+            continue;
+         TopoDS_Vertex keep = TopoDS::Vertex(vertexEdges.FindKey(i + 1).Oriented(TopAbs_FORWARD));
+         for (int l = k + 1; l < count && points[order[l]].X() - points[i].X() <= tolerance; ++l) {
+            int j = order[l];
+            double distance = points[i].Distance(points[j]);
+            if (merged[j] || distance > tolerance || shareEdge(i, j))
+               continue;
+            TopoDS_Vertex duplicate = TopoDS::Vertex(vertexEdges.FindKey(j + 1).Oriented(TopAbs_FORWARD));
+            builder.UpdateVertex(keep, std::max(BRep_Tool::Tolerance(keep), distance + BRep_Tool::Tolerance(duplicate)));
+            reShape->Replace(duplicate, keep);
+            merged[j] = true;
+            ++mergedCount;
+         }
+      }
+      if (mergedCount == 0)
+         return shape;
+      return reShape->Apply(shape);
+   }
+
+   // Rough size of a shape: the topology, the geometry with its poles and the meshes.
+   // Shared sub-shapes and geometry are counted once
+   static std::size_t EstimateShapeBytes(const TopoDS_Shape& shape) {
+      if (shape.IsNull())
+         return 0;
+      std::size_t bytes = 0;
+      std::set<const Standard_Transient*> counted;
+      auto count = [&](const Handle(Standard_Transient)& object, std::size_t payload) {
+         if (!object.IsNull() && counted.insert(object.get()).second)
+            bytes += object->DynamicType()->Size() + payload;
+      };
+
+      TopTools_IndexedMapOfShape subShapes;
+      TopExp::MapShapes(shape, subShapes);
+      for (int i = 1; i <= subShapes.Extent(); ++i) {
+         const TopoDS_Shape& subShape = subShapes(i);
+         count(subShape.TShape(), 0);
+         TopLoc_Location location;
+         if (subShape.ShapeType() == TopAbs_FACE) {
+            const TopoDS_Face& face = TopoDS::Face(subShape);
+            const Handle(Geom_Surface)& surface = BRep_Tool::Surface(face, location);
+            Handle(Geom_BSplineSurface) bspline = Handle(Geom_BSplineSurface)::DownCast(surface);
+            count(surface, bspline.IsNull() ? 0 : bspline->NbUPoles() * bspline->NbVPoles() * (sizeof(gp_Pnt) + sizeof(double)));
+            const Handle(Poly_Triangulation)& mesh = BRep_Tool::Triangulation(face, location);
+            if (!mesh.IsNull())
+               count(mesh, mesh->NbNodes() * (sizeof(gp_Pnt) + sizeof(gp_Pnt2d)) + mesh->NbTriangles() * sizeof(Poly_Triangle));
+         }
+         else if (subShape.ShapeType() == TopAbs_EDGE) {
+            double first, last;
+            const Handle(Geom_Curve)& curve = BRep_Tool::Curve(TopoDS::Edge(subShape), location, first, last);
+            Handle(Geom_BSplineCurve) bspline = Handle(Geom_BSplineCurve)::DownCast(curve);
+            count(curve, bspline.IsNull() ? 0 : bspline->NbPoles() * (sizeof(gp_Pnt) + sizeof(double)));
+         }
+      }
+      return bytes;
+   }
+
+   // Size of one geometry object, used to estimate the memory freed by sharing it
+   static std::size_t GeometryBytes(const Handle(Standard_Transient)& geometry) {
+      return geometry->DynamicType()->Size();
+   }
+
+   // Share the surfaces and curves of repeated features: every cylinder, cone, sphere, torus,
+   // circle or ellipse that is the same as an earlier one up to a rigid motion is replaced by
+   // the earlier geometry placed with a TopLoc_Location. The placement maps the parametrization
+   // one to one, so the pcurves and edge ranges carry over unchanged. Planes are left alone, they
+   // are cheap and mostly unique. Modifies the shape in place and returns the bytes saved
+   static std::size_t ShareRepeatedGeometry(const TopoDS_Shape& shape, double tolerance) {
+      struct SurfaceKey {
+         const Standard_Type* type;
+         long long radius1;
+         long long radius2;
+         bool direct;
+         bool operator<(const SurfaceKey& other) const {
+            return std::tie(type, radius1, radius2, direct) <
+               std::tie(other.type, other.radius1, other.radius2, other.direct);
+         }
+      };
+      auto quantize = [tolerance](double value) { return (long long)std::llround(value / tolerance); };
+
+      // The shared surface and its placement for every original surface that can be replaced
+      std::map<SurfaceKey, Handle(Geom_ElementarySurface)> sharedSurfaces;
+      std::map<const Geom_Surface*, std::pair<Handle(Geom_ElementarySurface), TopLoc_Location>> surfacePlacements;
+      auto placeSurface = [&](const Handle(Geom_Surface)& surface) -> bool {
+         if (surfacePlacements.count(surface.get()))
+            return true;
+         Handle(Geom_ElementarySurface) elementary = Handle(Geom_ElementarySurface)::DownCast(surface);
+         if (elementary.IsNull() || elementary->IsKind(STANDARD_TYPE(Geom_Plane)))
+            return false;
+
+         SurfaceKey key{ elementary->DynamicType().get(), 0, 0, elementary->Position().Direct() };
+         if (auto cylinder = Handle(Geom_CylindricalSurface)::DownCast(elementary))
+            key.radius1 = quantize(cylinder->Radius());
+         else if (auto cone = Handle(Geom_ConicalSurface)::DownCast(elementary)) {
+            key.radius1 = quantize(cone->RefRadius());
+            key.radius2 = quantize(cone->SemiAngle() * 1000.0);
+         }
+         else if (auto sphere = Handle(Geom_SphericalSurface)::DownCast(elementary))
+            key.radius1 = quantize(sphere->Radius());
+         else if (auto torus = Handle(Geom_ToroidalSurface)::DownCast(elementary)) {
+            key.radius1 = quantize(torus->MajorRadius());
+            key.radius2 = quantize(torus->MinorRadius());
+         }
+         else
+            return false;
+
+         Handle(Geom_ElementarySurface)& shared = sharedSurfaces[key];
+         if (shared.IsNull())
+            shared = elementary;
+         gp_Trsf placement;
+         placement.SetDisplacement(shared->Position(), elementary->Position());
+
+         // The quantized key lets close radii through; insist on the same parametrization
+         for (double u : { 0.0, 1.0 }) {
+            for (double v : { 0.0, 1.0 }) {
+               if (shared->Value(u, v).Transformed(placement).Distance(elementary->Value(u, v)) > tolerance)
+                  return false;
             }
          }
+         surfacePlacements[surface.get()] = { shared, TopLoc_Location(placement) };
+         return true;
+      };
+
+      struct PCurves {
+         TopoDS_Edge edge;
+         Handle(Geom2d_Curve) forward;
+         Handle(Geom2d_Curve) reversed; // Set on closed surfaces, where the edge has two pcurves
+         double first, last;
+      };
+      // Faces to re-seat with the pcurves of their edges, all read before any face is changed,
+      // since faces on the same original surface share the pcurve entries
+      std::vector<std::pair<TopoDS_Face, std::vector<PCurves>>> faceUpdates;
+      TopTools_IndexedMapOfShape faces;
+      TopExp::MapShapes(shape, TopAbs_FACE, faces);
+      for (int i = 1; i <= faces.Extent(); ++i) {
+         TopoDS_Face face = TopoDS::Face(faces(i).Oriented(TopAbs_FORWARD));
+         TopLoc_Location location;
+         const Handle(Geom_Surface)& surface = BRep_Tool::Surface(face, location);
+         if (!location.IsIdentity() || surface.IsNull() || !placeSurface(surface))
+            continue;
+
+         std::vector<PCurves> pcurves;
+         TopTools_MapOfShape visited;
+         bool shareable = true;
+         for (TopExp_Explorer edgeExp(face, TopAbs_EDGE); edgeExp.More() && shareable; edgeExp.Next()) {
+            TopoDS_Edge edge = TopoDS::Edge(edgeExp.Current().Oriented(TopAbs_FORWARD));
+            if (!visited.Add(edge))
+               continue;
+            PCurves entry{ edge };
+            entry.forward = BRep_Tool::CurveOnSurface(edge, face, entry.first, entry.last);
+            if (BRep_Tool::IsClosed(edge, face))
+               entry.reversed = BRep_Tool::CurveOnSurface(TopoDS::Edge(edge.Reversed()), face, entry.first, entry.last);
+            shareable = edge.Location().IsIdentity() && !entry.forward.IsNull();
+            pcurves.push_back(entry);
+         }
+         if (shareable)
+            faceUpdates.push_back({ face, pcurves });
+      }
 
-         // Combine local results into the global minimum
-#pragma omp critical
-         {
-            if (localMinDistance < minDistance) {
-               minDistance = localMinDistance;
+      // Each replaced object is freed once no face or edge uses it any more
+      std::size_t bytesSaved = 0;
+      BRep_Builder builder;
+      std::set<const Geom_Surface*> replacedSurfaces;
+      for (const auto& [face, pcurves] : faceUpdates) {
+         TopLoc_Location location;
+         Handle(Geom_Surface) surface = BRep_Tool::Surface(face, location);
+         const auto& [shared, placement] = surfacePlacements[surface.get()];
+         if (shared == surface)
+            continue;
+         double tol = BRep_Tool::Tolerance(face);
+         builder.UpdateFace(face, shared, placement, tol);
+         for (const PCurves& entry : pcurves) {
+            double edgeTol = BRep_Tool::Tolerance(entry.edge);
+            builder.UpdateEdge(entry.edge, Handle(Geom2d_Curve)(), surface, location, edgeTol);
+            if (entry.reversed.IsNull())
+               builder.UpdateEdge(entry.edge, entry.forward, shared, placement, edgeTol);
+            else
+               builder.UpdateEdge(entry.edge, entry.forward, entry.reversed, shared, placement, edgeTol);
+            builder.Range(entry.edge, shared, placement, entry.first, entry.last);
+         }
+         if (replacedSurfaces.insert(surface.get()).second)
+            bytesSaved += GeometryBytes(surface);
+      }
+
+      // Circles and ellipses of the hole and slot outlines
+      struct CurveKey {
+         const Standard_Type* type;
+         long long radius1;
+         long long radius2;
+         bool operator<(const CurveKey& other) const {
+            return std::tie(type, radius1, radius2) < std::tie(other.type, other.radius1, other.radius2);
+         }
+      };
+      std::map<CurveKey, Handle(Geom_Conic)> sharedCurves;
+      std::set<const Geom_Curve*> replacedCurves;
+      TopTools_IndexedMapOfShape edges;
+      TopExp::MapShapes(shape, TopAbs_EDGE, edges);
+      for (int i = 1; i <= edges.Extent(); ++i) {
+         TopoDS_Edge edge = TopoDS::Edge(edges(i).Oriented(TopAbs_FORWARD));
+         TopLoc_Location location;
+         double first, last;
+         Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, location, first, last);
+         Handle(Geom_Conic) conic = Handle(Geom_Conic)::DownCast(curve);
+         if (!location.IsIdentity() || !edge.Location().IsIdentity() || conic.IsNull())
+            continue;
+
+         CurveKey key{ conic->DynamicType().get(), 0, 0 };
+         if (auto circle = Handle(Geom_Circle)::DownCast(conic))
+            key.radius1 = quantize(circle->Radius());
+         else if (auto ellipse = Handle(Geom_Ellipse)::DownCast(conic)) {
+            key.radius1 = quantize(ellipse->MajorRadius());
+            key.radius2 = quantize(ellipse->MinorRadius());
+         }
+         else
+            continue;
+
+         Handle(Geom_Conic)& shared = sharedCurves[key];
+         if (shared.IsNull()) {
+            shared = conic;
+            continue;
+         }
+         gp_Trsf placement;
+         placement.SetDisplacement(gp_Ax3(shared->Position()), gp_Ax3(conic->Position()));
+         if (shared->Value(first).Transformed(placement).Distance(conic->Value(first)) > tolerance ||
+            shared->Value(last).Transformed(placement).Distance(conic->Value(last)) > tolerance)
+            continue;
+
+         builder.UpdateEdge(edge, shared, TopLoc_Location(placement), BRep_Tool::Tolerance(edge));
+         builder.Range(edge, first, last, Standard_True);
+         if (replacedCurves.insert(curve.get()).second)
+            bytesSaved += GeometryBytes(curve);
+      }
+
+      // Each new placement costs one location datum
+      std::size_t placementBytes = (replacedSurfaces.size() + replacedCurves.size()) *
+         STANDARD_TYPE(TopLoc_Datum3D)->Size();
+      bytesSaved = bytesSaved > placementBytes ? bytesSaved - placementBytes : 0;
+      return bytesSaved;
+   }
+
+   // Hand a transformed copy of the prototype face's mesh to a face that repeats it. The faces
+   // must share their surface, the repeat being placed by a rigid motion; every edge must map
+   // onto an edge of the repeat. Returns false, leaving the face untouched, when they do not match
+   static bool CopyInstanceMesh(const TopoDS_Face& prototype, const TopoDS_Face& face) {
+      TopLoc_Location prototypeLocation, faceLocation;
+      BRep_Tool::Surface(prototype, prototypeLocation);
+      BRep_Tool::Surface(face, faceLocation);
+      gp_Trsf trsf = faceLocation.Transformation() * prototypeLocation.Transformation().Inverted();
+
+      TopLoc_Location meshLocation;
+      const Handle(Poly_Triangulation)& mesh = BRep_Tool::Triangulation(prototype, meshLocation);
+      if (mesh.IsNull() || !meshLocation.IsIdentity())
+         return false;
+
+      auto edgePoints = [](const TopoDS_Edge& edge, gp_Pnt& first, gp_Pnt& mid, gp_Pnt& last) {
+         BRepAdaptor_Curve curve(edge);
+         first = curve.Value(curve.FirstParameter());
+         mid = curve.Value(0.5 * (curve.FirstParameter() + curve.LastParameter()));
+         last = curve.Value(curve.LastParameter());
+      };
+
+      TopTools_IndexedMapOfShape prototypeEdges, faceEdges;
+      TopExp::MapShapes(prototype, TopAbs_EDGE, prototypeEdges);
+      TopExp::MapShapes(face, TopAbs_EDGE, faceEdges);
+      if (prototypeEdges.Extent() != faceEdges.Extent())
+         return false;
+
+      struct EdgeMesh {
+         TopoDS_Edge edge;
+         Handle(Poly_PolygonOnTriangulation) forward;
+         Handle(Poly_PolygonOnTriangulation) reversed;
+      };
+      std::vector<EdgeMesh> edgeMeshes;
+      for (int i = 1; i <= prototypeEdges.Extent(); ++i) {
+         TopoDS_Edge prototypeEdge = TopoDS::Edge(prototypeEdges(i).Oriented(TopAbs_FORWARD));
+         gp_Pnt first, mid, last;
+         edgePoints(prototypeEdge, first, mid, last);
+         first.Transform(trsf);
+         mid.Transform(trsf);
+         last.Transform(trsf);
+
+         EdgeMesh edgeMesh;
+         for (int j = 1; j <= faceEdges.Extent() && edgeMesh.edge.IsNull(); ++j) {
+            TopoDS_Edge faceEdge = TopoDS::Edge(faceEdges(j).Oriented(TopAbs_FORWARD));
+            double tol = std::max(BRep_Tool::Tolerance(faceEdge), Precision::Confusion());
+            gp_Pnt faceFirst, faceMid, faceLast;
+            edgePoints(faceEdge, faceFirst, faceMid, faceLast);
+            if (first.Distance(faceFirst) < tol && mid.Distance(faceMid) < tol && last.Distance(faceLast) < tol)
+               edgeMesh.edge = faceEdge;
+         }
+         if (edgeMesh.edge.IsNull())
+            return false;
+
+         edgeMesh.forward = BRep_Tool::PolygonOnTriangulation(prototypeEdge, mesh, meshLocation);
+         if (BRep_Tool::IsClosed(prototypeEdge, prototype))
+            edgeMesh.reversed = BRep_Tool::PolygonOnTriangulation(TopoDS::Edge(prototypeEdge.Reversed()), mesh, meshLocation);
+         if (edgeMesh.forward.IsNull())
+            return false;
+         edgeMeshes.push_back(edgeMesh);
+      }
+
+      // Same surface, same parametrization: only the nodes and normals move, the UVs carry over
+      Handle(Poly_Triangulation) copy = mesh->Copy();
+      for (int i = 1; i <= mesh->NbNodes(); ++i) {
+         copy->SetNode(i, mesh->Node(i).Transformed(trsf));
+         if (mesh->HasNormals())
+            copy->SetNormal(i, mesh->Normal(i).Transformed(trsf));
+      }
+
+      BRep_Builder builder;
+      builder.UpdateFace(face, copy);
+      for (const EdgeMesh& edgeMesh : edgeMeshes) {
+         if (edgeMesh.reversed.IsNull())
+            builder.UpdateEdge(edgeMesh.edge, edgeMesh.forward->Copy(), copy, TopLoc_Location());
+         else
+            builder.UpdateEdge(edgeMesh.edge, edgeMesh.forward->Copy(), edgeMesh.reversed->Copy(), copy, TopLoc_Location());
+      }
+      return true;
+   }
+
+   // Mesh the faces of a shape whose geometry was shared by ShareRepeatedGeometry: each
+   // repeated feature is tessellated once and its repeats get transformed copies. The faces
+   // that are not repeats are left to the regular meshing of the display
+   static void MeshInstanced(const TopoDS_Shape& shape, double deflection) {
+      // Faces sharing a surface and an edge count are candidate repeats of each other
+      std::map<std::pair<const Geom_Surface*, int>, std::vector<TopoDS_Face>> groups;
+      TopTools_IndexedMapOfShape faces;
+      TopExp::MapShapes(shape, TopAbs_FACE, faces);
+      for (int i = 1; i <= faces.Extent(); ++i) {
+         TopoDS_Face face = TopoDS::Face(faces(i).Oriented(TopAbs_FORWARD));
+         TopLoc_Location location;
+         const Handle(Geom_Surface)& surface = BRep_Tool::Surface(face, location);
+         if (surface.IsNull() || surface->IsKind(STANDARD_TYPE(Geom_Plane)) || !face.Location().IsIdentity())
+            continue;
+         int edgeCount = 0;
+         for (TopExp_Explorer edgeExp(face, TopAbs_EDGE); edgeExp.More(); edgeExp.Next())
+            ++edgeCount;
+         groups[{ surface.get(), edgeCount }].push_back(face);
+      }
+
+      // A few prototypes per group cover the usual hole patterns; beyond that the search costs more
+      // than meshing
+      const std::size_t maxPrototypes = 8;
+      for (auto& [key, group] : groups) {
+         if (group.size() < 2)
+            continue;
+         std::vector<TopoDS_Face> prototypes;
+         for (const TopoDS_Face& face : group) {
+            TopLoc_Location meshLocation;
+            if (!BRep_Tool::Triangulation(face, meshLocation).IsNull()) {
+               if (prototypes.size() < maxPrototypes)
+                  prototypes.push_back(face);
+               continue;
+            }
+            bool isCopy = false;
+            for (auto it = prototypes.rbegin(); it != prototypes.rend() && !isCopy; ++it)
+               isCopy = CopyInstanceMesh(*it, face);
+            if (isCopy)
+               continue;
+            BRepMesh_IncrementalMesh mesher(face, deflection);
+            if (prototypes.size() < maxPrototypes)
+               prototypes.push_back(face);
+         }
+      }
+   }
+
+   // Collect the planar end caps at one X end of a part: faces that are flat in X
+   // and lie on the X extreme of the part
+   static bool EndFaces(const std::vector<FaceBox>& faceBoxes, bool atXMax, double tolerance,
+      TopoDS_Compound& rEndFaces) {
+      double partXMin = std::numeric_limits<double>::max();
+      double partXMax = std::numeric_limits<double>::lowest();
+      for (const FaceBox& faceBox : faceBoxes) {
+         if (faceBox.box.IsVoid())
+            continue;
+
+         double xmin, ymin, zmin, xmax, ymax, zmax;
+         faceBox.box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+         partXMin = std::min(partXMin, xmin);
+         partXMax = std::max(partXMax, xmax);
+      }
+
+      BRep_Builder builder;
+      builder.MakeCompound(rEndFaces);
+      bool found = false;
+      for (const FaceBox& faceBox : faceBoxes) {
+         if (faceBox.box.IsVoid())
+            continue;
+
+         double xmin, ymin, zmin, xmax, ymax, zmax;
+         faceBox.box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+         double slack = tolerance + 2 * faceBox.box.GetGap();
+         if (xmax - xmin > slack)
+            continue; // Not flat in X, a web or a flange running along the part
+
+         double endX = atXMax ? partXMax : partXMin;
+         if (std::abs((atXMax ? xmax : xmin) - endX) > slack)
+            continue;
+
+         builder.Add(rEndFaces, faceBox.face);
+         found = true;
+      }
+      return found;
+   }
+
+   // Exact signed X gap between the facing end caps of the left and right parts.
+   // Positive values are a separation, negative values an overlap. Only the end
+   // caps are handed to BRepExtrema, never the whole parts
+   static bool ContactGapX(const std::vector<FaceBox>& leftFaceBoxes,
+      const std::vector<FaceBox>& rightFaceBoxes, double& rGap) {
+      TopoDS_Compound leftEnd, rightEnd;
+      if (!EndFaces(leftFaceBoxes, true, 0.1, leftEnd) || !EndFaces(rightFaceBoxes, false, 0.1, rightEnd))
+         return false;
+
+      BRepExtrema_DistShapeShape distAlgo;
+      distAlgo.SetMultiThread(Standard_True);
+      distAlgo.LoadS1(leftEnd);
+      distAlgo.LoadS2(rightEnd);
+      distAlgo.Perform();
+      if (!distAlgo.IsDone() || distAlgo.NbSolution() == 0)
+         return false;
+
+      rGap = std::numeric_limits<double>::max();
+      for (int i = 1; i <= distAlgo.NbSolution(); ++i) {
+         double dx = distAlgo.PointOnShape2(i).X() - distAlgo.PointOnShape1(i).X();
+         if (std::abs(dx) < std::abs(rGap))
+            rGap = dx;
+      }
+      return true;
+   }
+
+   // X gap between the boxes of the left and the right part. A rough stand-in when
+   // there is no time to measure the distance of the parts
+   static double BoxGapX(const std::vector<FaceBox>& leftFaceBoxes, const std::vector<FaceBox>& rightFaceBoxes) {
+      Bnd_Box leftBox, rightBox;
+      for (const FaceBox& faceBox : leftFaceBoxes)
+         leftBox.Add(faceBox.box);
+      for (const FaceBox& faceBox : rightFaceBoxes)
+         rightBox.Add(faceBox.box);
+      if (leftBox.IsVoid() || rightBox.IsVoid())
+         return 0;
+      return rightBox.CornerMin().X() - leftBox.CornerMax().X();
+   }
+
+   // Triangles of the end caps seen along X, as Y/Z triples. The caps get a coarse mesh,
+   // a tenth of their size, which is all a silhouette needs
+   static std::vector<std::array<double, 6>> EndCapTriangles(const TopoDS_Compound& endFaces) {
+      std::vector<std::array<double, 6>> triangles;
+      Bnd_Box box;
+      BRepBndLib::Add(endFaces, box);
+      if (box.IsVoid())
+         return triangles;
+      BRepMesh_IncrementalMesh mesher(endFaces, 0.1 * std::sqrt(box.SquareExtent()));
+
+      for (TopExp_Explorer explorer(endFaces, TopAbs_FACE); explorer.More(); explorer.Next()) {
+         TopLoc_Location location;
+         const Handle(Poly_Triangulation)& mesh = BRep_Tool::Triangulation(TopoDS::Face(explorer.Current()), location);
+         if (mesh.IsNull())
+            continue;
+         for (int i = 1; i <= mesh->NbTriangles(); ++i) {
+            int n[3];
+            mesh->Triangle(i).Get(n[0], n[1], n[2]);
+            std::array<double, 6> triangle;
+            for (int k = 0; k < 3; k++) {
+               gp_Pnt node = mesh->Node(n[k]).Transformed(location.Transformation());
+               triangle[2 * k] = node.Y();
+               triangle[2 * k + 1] = node.Z();
             }
+            triangles.push_back(triangle);
          }
       }
+      return triangles;
+   }
+
+   // Cells of a YZ grid covered by the triangles. A cell is covered when its center is
+   // inside a triangle
+   static std::vector<char> RasterizeYZ(const std::vector<std::array<double, 6>>& triangles,
+      double y0, double z0, double cell, int ny, int nz) {
+      std::vector<char> mask(ny * nz, 0);
+      for (const auto& t : triangles) {
+         double ymin = std::min({ t[0], t[2], t[4] }), ymax = std::max({ t[0], t[2], t[4] });
+         double zmin = std::min({ t[1], t[3], t[5] }), zmax = std::max({ t[1], t[3], t[5] });
+         int i0 = std::max(0, (int)((ymin - y0) / cell)), i1 = std::min(ny - 1, (int)((ymax - y0) / cell));
+         int j0 = std::max(0, (int)((zmin - z0) / cell)), j1 = std::min(nz - 1, (int)((zmax - z0) / cell));
+         for (int j = j0; j <= j1; j++) {
+            for (int i = i0; i <= i1; i++) {
+               double y = y0 + (i + 0.5) * cell, z = z0 + (j + 0.5) * cell;
+               double d1 = (t[2] - t[0]) * (z - t[1]) - (t[3] - t[1]) * (y - t[0]);
+               double d2 = (t[4] - t[2]) * (z - t[3]) - (t[5] - t[3]) * (y - t[2]);
+               double d3 = (t[0] - t[4]) * (z - t[5]) - (t[1] - t[5]) * (y - t[4]);
+               bool hasNeg = d1 < 0 || d2 < 0 || d3 < 0, hasPos = d1 > 0 || d2 > 0 || d3 > 0;
+               if (!(hasNeg && hasPos))
+                  mask[j * ny + i] = 1;
+            }
+         }
+      }
+      return mask;
+   }
+
+   // Connected patches (4-neighbours) of a grid mask
+   static int CountPatches(std::vector<char> mask, int ny, int nz) {
+      int patches = 0;
+      std::vector<int> stack;
+      for (int start = 0; start < ny * nz; start++) {
+         if (!mask[start])
+            continue;
+         patches++;
+         mask[start] = 0;
+         stack.push_back(start);
+         while (!stack.empty()) {
+            int cell = stack.back();
+            stack.pop_back();
+            int i = cell % ny, j = cell / ny;
+            int neighbours[4] = { i > 0 ? cell - 1 : -1, i < ny - 1 ? cell + 1 : -1,
+               j > 0 ? cell - ny : -1, j < nz - 1 ? cell + ny : -1 };
+            for (int next : neighbours) {
+               if (next >= 0 && mask[next]) {
+                  mask[next] = 0;
+                  stack.push_back(next);
+               }
+            }
+         }
+      }
+      return patches;
+   }
+
+   // Pre-flight of a join: compare the end cap silhouettes of the parts seen along X, as the
+   // right part is, rolled, yawed, and both. Yaw and roll turn about the middle of the part,
+   // a yaw also brings its other end to the joint. Runs on coarse meshes of the end caps only
+   static JoinCheck CheckContact(const std::vector<FaceBox>& leftFaceBoxes,
+      const std::vector<FaceBox>& rightFaceBoxes, const TopoDS_Shape& rightShape) {
+      JoinCheck check;
+      TopoDS_Compound leftEnd, rightNear, rightFar;
+      if (!EndFaces(leftFaceBoxes, true, 0.1, leftEnd) || !EndFaces(rightFaceBoxes, false, 0.1, rightNear))
+         return check;
+      bool hasFar = EndFaces(rightFaceBoxes, true, 0.1, rightFar);
+
+      Bnd_Box rightBox;
+      BRepBndLib::Add(rightShape, rightBox);
+      double xmin, ymin, zmin, xmax, ymax, zmax;
+      rightBox.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+      double yMid = 0.5 * (ymin + ymax), zMid = 0.5 * (zmin + zmax);
+
+      auto flipped = [](std::vector<std::array<double, 6>> triangles, bool flipY, double yMid, bool flipZ, double zMid) {
+         for (auto& t : triangles) {
+            for (int k = 0; k < 3; k++) {
+               if (flipY) t[2 * k] = 2 * yMid - t[2 * k];
+               if (flipZ) t[2 * k + 1] = 2 * zMid - t[2 * k + 1];
+            }
+         }
+         return triangles;
+      };
+
+      struct Candidate {
+         const char* suggestion;
+         std::vector<std::array<double, 6>> triangles;
+      };
+      auto nearTriangles = EndCapTriangles(rightNear);
+      std::vector<Candidate> candidates;
+      candidates.push_back({ "", nearTriangles });
+      candidates.push_back({ "Roll Part 2 by 180", flipped(nearTriangles, true, yMid, true, zMid) });
+      if (hasFar) {
+         auto farTriangles = EndCapTriangles(rightFar);
+         candidates.push_back({ "Yaw Part 2 by 180", flipped(farTriangles, true, yMid, false, zMid) });
+         candidates.push_back({ "Yaw and roll Part 2 by 180", flipped(farTriangles, false, yMid, true, zMid) });
+      }
+      auto leftTriangles = EndCapTriangles(leftEnd);
+      if (leftTriangles.empty() || nearTriangles.empty())
+         return check;
+
+      // One grid over every silhouette, 96 cells along its longer side
+      double y0 = std::numeric_limits<double>::max(), z0 = y0;
+      double y1 = std::numeric_limits<double>::lowest(), z1 = y1;
+      auto extend = [&](const std::vector<std::array<double, 6>>& triangles) {
+         for (const auto& t : triangles) {
+            for (int k = 0; k < 3; k++) {
+               y0 = std::min(y0, t[2 * k]); y1 = std::max(y1, t[2 * k]);
+               z0 = std::min(z0, t[2 * k + 1]); z1 = std::max(z1, t[2 * k + 1]);
+            }
+         }
+      };
+      extend(leftTriangles);
+      for (const auto& candidate : candidates)
+         extend(candidate.triangles);
+      double cell = std::max({ y1 - y0, z1 - z0, Precision::Confusion() }) / 96;
+      int ny = (int)((y1 - y0) / cell) + 1, nz = (int)((z1 - z0) / cell) + 1;
+
+      std::vector<char> leftMask = RasterizeYZ(leftTriangles, y0, z0, cell, ny, nz);
+      double bestOverlap = -1;
+      for (std::size_t c = 0; c < candidates.size(); c++) {
+         std::vector<char> rightMask = RasterizeYZ(candidates[c].triangles, y0, z0, cell, ny, nz);
+         std::vector<char> common(ny * nz);
+         int both = 0, either = 0;
+         for (int i = 0; i < ny * nz; i++) {
+            common[i] = leftMask[i] && rightMask[i];
+            both += common[i];
+            either += leftMask[i] || rightMask[i];
+         }
+         double overlap = either ? (double)both / either : 0;
+         if (c == 0) {
+            check.checked = true;
+            check.overlap = overlap;
+            check.patches = CountPatches(common, ny, nz);
+            check.contact = check.patches == 1 && overlap >= JoinCheck::MinOverlap;
+         }
+         else if (overlap > bestOverlap) {
+            bestOverlap = overlap;
+            if (overlap >= JoinCheck::MinOverlap && overlap > check.overlap + 0.2)
+               check.suggestion = candidates[c].suggestion;
+         }
+      }
+      if (check.contact)
+         check.suggestion.clear();
+      return check;
+   }
+
+   static double FindMinDistance(const std::pmr::vector<gp_Pnt>& midpoints1, const std::pmr::vector<gp_Pnt>& midpoints2) {
+      // Minimum of each row, then of the rows
+      std::pmr::vector<double> rowMin(midpoints1.size(), std::numeric_limits<double>::max(),
+         midpoints1.get_allocator());
+      Concurrency::For((int)midpoints1.size(), [&](int i) {
+         for (const gp_Pnt& point : midpoints2)
+            rowMin[i] = std::min(rowMin[i], midpoints1[i].Distance(point));
+      });
+
+      double minDistance = std::numeric_limits<double>::max();
+      for (double distance : rowMin)
+         minDistance = std::min(minDistance, distance);
       return minDistance;
    }
 
@@ -180,8 +1271,9 @@ class OCCTUtils {
    }
 
    // Compute the minimum distance using edge midpoints
-   static double EdgeMidpointDistance(const TopoDS_Shape& shape1, const TopoDS_Shape& shape2) {
-      std::vector<gp_Pnt> midpoints1, midpoints2;
+   static double EdgeMidpointDistance(const TopoDS_Shape& shape1, const TopoDS_Shape& shape2,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) {
+      std::pmr::vector<gp_Pnt> midpoints1(scratch), midpoints2(scratch);
 
       // Extract edges and compute midpoints for shape1
       for (TopExp_Explorer edgeExp(shape1, TopAbs_EDGE); edgeExp.More(); edgeExp.Next()) {
@@ -220,18 +1312,19 @@ class OCCTUtils {
       return fusedShape;
    }
 
-   static TopoDS_Shape HandleIntersectingBoundingCurves(const TopoDS_Shape& shape, double tolerance) {
+   static TopoDS_Shape HandleIntersectingBoundingCurves(const TopoDS_Shape& shape, double tolerance,
+      const Handle(Message_ProgressIndicator)& indicator = Handle(Message_ProgressIndicator)()) {
       auto cpShape = OCCTUtils::CopyShape(shape);
 
       // Step 1: Sew gaps between surfaces
       BRepBuilderAPI_Sewing sewing(tolerance);
       sewing.Add(cpShape);
-      sewing.Perform();
+      sewing.Perform(StepRange(indicator));
       TopoDS_Shape sewedShape = sewing.SewedShape();
 
       // Step 2: Fuse surfaces to create a single solid
-      BRepAlgoAPI_Fuse fuse(sewedShape, sewedShape); // Self-fuse
-      fuse.Build();
+      BRepAlgoAPI_Fuse fuse(sewedShape, sewedShape, StepRange(indicator)); // Self-fuse
+      fuse.Build(StepRange(indicator));
       cpShape = fuse.Shape();
 
       // Step 3: Refine the shape to remove small edges
@@ -244,11 +1337,498 @@ class OCCTUtils {
       // Step 4: Heal the shape to fix gaps and ensure continuity
       Handle(ShapeFix_Shape) shapeFix = new ShapeFix_Shape(cpShape);
       shapeFix->SetPrecision(1e-3); // Set tolerance for fixing gaps
-      shapeFix->Perform(); // Perform the healing operation
+      shapeFix->Perform(StepRange(indicator)); // Perform the healing operation
 
       return shapeFix->Shape();
    }
 
+   // Faces of a boolean result that the operation modified or generated from the
+   // faces of its arguments and tools, i.e. the faces around the joint
+   static TopTools_IndexedMapOfShape JointFaces(BRepAlgoAPI_BooleanOperation& booleanOp) {
+      TopTools_IndexedMapOfShape jointFaces;
+      for (const TopTools_ListOfShape* inputs : { &booleanOp.Arguments(), &booleanOp.Tools() }) {
+         for (const TopoDS_Shape& input : *inputs) {
+            for (TopExp_Explorer faceExp(input, TopAbs_FACE); faceExp.More(); faceExp.Next()) {
+               for (const TopoDS_Shape& modified : booleanOp.Modified(faceExp.Current()))
+                  jointFaces.Add(modified);
+               for (const TopoDS_Shape& generated : booleanOp.Generated(faceExp.Current()))
+                  if (generated.ShapeType() == TopAbs_FACE)
+                     jointFaces.Add(generated);
+            }
+         }
+      }
+      return jointFaces;
+   }
+
+   static bool IsSingleSolid(const TopoDS_Shape& shape) {
+      TopTools_IndexedMapOfShape solids;
+      TopExp::MapShapes(shape, TopAbs_SOLID, solids);
+      return solids.Extent() == 1;
+   }
+
+   // Glue option for parts placed exactly in contact: GlueFull when the facing end
+   // caps coincide completely, GlueShift when they only overlap partially
+   static BOPAlgo_GlueEnum ContactGlue(const TopoDS_Compound& endFaces1, const TopoDS_Compound& endFaces2,
+      double tolerance) {
+      GProp_GProps props1, props2;
+      BRepGProp::SurfaceProperties(endFaces1, props1);
+      BRepGProp::SurfaceProperties(endFaces2, props2);
+
+      Bnd_Box box1, box2;
+      BRepBndLib::Add(endFaces1, box1);
+      BRepBndLib::Add(endFaces2, box2);
+      double xmin1, ymin1, zmin1, xmax1, ymax1, zmax1;
+      double xmin2, ymin2, zmin2, xmax2, ymax2, zmax2;
+      box1.Get(xmin1, ymin1, zmin1, xmax1, ymax1, zmax1);
+      box2.Get(xmin2, ymin2, zmin2, xmax2, ymax2, zmax2);
+
+      bool sameProfile = std::abs(ymin1 - ymin2) < tolerance && std::abs(ymax1 - ymax2) < tolerance
+         && std::abs(zmin1 - zmin2) < tolerance && std::abs(zmax1 - zmax2) < tolerance
+         && std::abs(props1.Mass() - props2.Mass()) < tolerance * std::sqrt(props1.Mass());
+      return sameProfile ? BOPAlgo_GlueFull : BOPAlgo_GlueShift;
+   }
+
+   // Fuse on a pave filler of the job arena. Returns null when the intersection fails or is
+   // interrupted
+   static std::unique_ptr<BRepAlgoAPI_Fuse> ArenaFuse(const TopoDS_Shape& shape1, const TopoDS_Shape& shape2,
+      BOPAlgo_GlueEnum glue, bool runParallel, JobArena& arena,
+      const Handle(Message_ProgressIndicator)& indicator = Handle(Message_ProgressIndicator)()) {
+      TopTools_ListOfShape arguments;
+      arguments.Append(shape1);
+      arguments.Append(shape2);
+
+      BOPAlgo_PaveFiller& filler = arena.NewFiller();
+      filler.SetArguments(arguments);
+      filler.SetGlue(glue);
+      filler.SetRunParallel(runParallel);
+      // A join that overran its deadline may still read the inputs
+      filler.SetNonDestructive(!indicator.IsNull());
+      filler.Perform(StepRange(indicator));
+      if (filler.HasErrors())
+         return nullptr;
+
+      return std::make_unique<BRepAlgoAPI_Fuse>(shape1, shape2, filler, StepRange(indicator));
+   }
+
+   // Fuse two parts that only touch along shared faces. The glue option skips most of
+   // the face/face intersections. Returns null unless the result is a single solid
+   static std::unique_ptr<BRepAlgoAPI_Fuse> GlueFuse(const TopoDS_Shape& shape1, const TopoDS_Shape& touchingShape2,
+      BOPAlgo_GlueEnum glue, JobArena& arena,
+      const Handle(Message_ProgressIndicator)& indicator = Handle(Message_ProgressIndicator)()) {
+      auto fuser = ArenaFuse(shape1, touchingShape2, glue, true, arena, indicator);
+      if (!fuser || !fuser->IsDone() || fuser->HasErrors() || !IsSingleSolid(fuser->Shape()))
+         return nullptr;
+      return fuser;
+   }
+
+   // Inputs of the join pipeline, gathered from the engine on the calling thread so that
+   // the pipeline can run on any thread
+   struct JoinInputs {
+      TopoDS_Shape left, right;
+      double gap = 0;                          // X gap between the parts, see ContactGapX
+      bool exactGap = false;                   // The gap is the exact one of the end caps
+      BOPAlgo_GlueEnum glue = BOPAlgo_GlueOff; // Of the end caps in contact, see ContactGlue
+      bool glueOnly = false;                   // No other fuse when the glue join fails
+   };
+
+   struct JoinResult {
+      TopoDS_Shape shape;                 // Last shape of the pipeline, also when it failed
+      Handle(BRepTools_History) history;  // Of the fuse
+      std::string error;                  // Empty when the shape is a valid join
+   };
+
+   // The join pipeline of UnionShapes and of the stages of BudgetedJoin: the fuse the options
+   // choose, the healing, the joint refinement, the merge of stray solids and the validation.
+   // With an indicator the booleans, the sewing and the healing stop at its user break.
+   // Throws FuseFailureException when not even the retry gives a shape
+   static JoinResult JoinParts(const JoinInputs& inputs, const JoinOptions& options,
+      const Handle(Message_ProgressIndicator)& indicator = Handle(Message_ProgressIndicator)()) {
+      JoinResult result;
+      auto interrupted = [&]() {
+         if (indicator.IsNull() || !indicator->UserBreak())
+            return false;
+         result.error = "Interrupted at the deadline";
+         return true;
+      };
+
+      TopoDS_Shape translatedRightShape = TranslateAlongX(inputs.right, -(inputs.gap + 0.01)); // Leave a 0.01 mm overlap
+
+      // The right part placed exactly in contact, for the glue joins
+      TopoDS_Shape touchingRightShape;
+      if (inputs.exactGap)
+         touchingRightShape = TranslateAlongX(inputs.right, -inputs.gap);
+
+      // Why the racing fuse strategies threw, named in the error of a join that fails
+      std::string strategyFailures;
+      auto failure = [&strategyFailures](const std::string& error) {
+         return strategyFailures.empty() ? error : error + " (fuse strategies: " + strategyFailures + ")";
+      };
+
+      // The intersection data and the scratch collections of this join, dropped after the fuse
+      std::optional<JobArena> arena;
+      arena.emplace();
+
+      // Perform the initial union operation: a glue join of the parts in contact, several
+      // fuse strategies racing on the spare cores, or one plain fuse of the overlapping parts
+      std::unique_ptr<BRepAlgoAPI_Fuse> fuser;
+      if ((options.glueJoin || inputs.glueOnly) && inputs.exactGap)
+         fuser = GlueFuse(inputs.left, touchingRightShape, inputs.glue, *arena, indicator);
+      if (!fuser && inputs.glueOnly) {
+         result.error = "The parts do not glue into a single solid";
+         return result;
+      }
+      if (!fuser && options.speculativeFuse && !interrupted())
+         fuser = SpeculativeFuse(inputs.left, translatedRightShape, touchingRightShape, strategyFailures);
+      if (!fuser && !interrupted())
+         fuser = ArenaFuse(inputs.left, translatedRightShape, BOPAlgo_GlueOff, false, *arena, indicator);
+      if (interrupted())
+         return result;
+
+      // Retrieve the initial fused shape. Only the compact history and the faces touched by the
+      // fuse are kept, the boolean data structure is freed before the healing
+      TopoDS_Shape fusedShape;
+      TopTools_IndexedMapOfShape jointFaces; // Followed through healing for the joint-only refinement
+      if (fuser && fuser->IsDone()) {
+         fusedShape = fuser->Shape();
+         // Copied out, the history of the builder may sit in the arena
+         result.history = new BRepTools_History();
+         if (!fuser->History().IsNull())
+            result.history->Merge(fuser->History());
+         if (options.localRefine)
+            jointFaces = JointFaces(*fuser);
+      }
+      fuser.reset();
+      arena.reset();
+
+      // Validate the fuse operation
+      if (fusedShape.IsNull())
+      {
+         // Try fusion once again
+         fusedShape = MergeShapesAlongX(inputs.left, translatedRightShape);
+         if (fusedShape.IsNull())
+            throw FuseFailureException(failure("Fusing input parts failed"));
+         fusedShape = FixShape(fusedShape, indicator);
+         if (fusedShape.IsNull())
+            throw FuseFailureException(failure("Fusing input parts failed"));
+      }
+      else if (options.targetedHealing)
+         fusedShape = FixShapeTargeted(fusedShape, options.localRefine ? &jointFaces : nullptr);
+      else if (options.localRefine)
+         fusedShape = FixShape(fusedShape, jointFaces, indicator);
+      else
+         fusedShape = FixShape(fusedShape, indicator);
+      result.shape = fusedShape;
+      if (interrupted())
+         return result;
+
+      // Call the function to handle intersecting bounding curves
+      double tolerance = 1e-1; // Adjust the tolerance as needed
+      if (options.localRefine)
+         fusedShape = RefineJoint(fusedShape, jointFaces, tolerance);
+      else
+         fusedShape = HandleIntersectingBoundingCurves(fusedShape, tolerance, indicator);
+      result.shape = fusedShape;
+      if (interrupted())
+         return result;
+
+      // Check for multiple connected components
+      TopTools_IndexedMapOfShape solids;
+      TopExp::MapShapes(fusedShape, TopAbs_SOLID, solids);
+
+      // If there's more than one solid, merge them
+      if (solids.Extent() > 1) {
+
+         // Start with the first solid
+         TopoDS_Shape unifiedSolid = solids(1);
+
+         // Iteratively fuse the remaining solids
+         for (int i = 2; i <= solids.Extent(); ++i) {
+            BRepAlgoAPI_Fuse iterativeFuser(unifiedSolid, solids(i), StepRange(indicator));
+            if (interrupted())
+               return result;
+            if (!iterativeFuser.IsDone()) {
+               result.error = failure("Iterative union operation failed");
+               return result;
+            }
+
+            unifiedSolid = iterativeFuser.Shape();
+         }
+
+         // Update the fused shape to the unified result
+         fusedShape = unifiedSolid;
+      }
+      result.shape = fusedShape;
+
+      // Validate the final fused shape. The fast verification settles the clear cases on the
+      // mass properties and leaves only the doubtful ones to the analyzer
+      Verdict verdict = Verdict::Inconclusive;
+      if (options.fastVerify) {
+         std::string reason;
+         verdict = VerifyConservation(inputs.left, translatedRightShape, fusedShape, 1e-3, reason);
+         if (verdict == Verdict::Fail) {
+            result.error = "Final fused shape is invalid, " + reason;
+            return result;
+         }
+      }
+      if (verdict == Verdict::Inconclusive) {
+         if (!IsShapeValid(fusedShape))
+            result.error = "Final fused shape is invalid";
+         else if (HasMultipleConnectedComponents(fusedShape))
+            result.error = "Fused shape contains multiple connected components";
+      }
+      if (!result.error.empty())
+         result.error = failure(result.error);
+      return result;
+   }
+
+   // Race several fuse configurations on the spare cores. The first one that gives a
+   // single solid wins and the others are cancelled through their progress indicator.
+   // The glue strategy needs the parts exactly in contact, it is skipped when
+   // touchingShape2 is null. Returns null when every strategy failed, with the strategies
+   // that threw and why in rFailures
+   static std::unique_ptr<BRepAlgoAPI_Fuse> SpeculativeFuse(const TopoDS_Shape& shape1,
+      const TopoDS_Shape& shape2, const TopoDS_Shape& touchingShape2, std::string& rFailures) {
+      static const FuseStrategy strategies[] = {
+         { "plain",         0.0,  BOPAlgo_GlueOff,   false },
+         { "fuzzy 1e-5",    1e-5, BOPAlgo_GlueOff,   false },
+         { "fuzzy 1e-4",    1e-4, BOPAlgo_GlueOff,   false },
+         { "fuzzy 1e-3",    1e-3, BOPAlgo_GlueOff,   false },
+         { "glue",          0.0,  BOPAlgo_GlueShift, false },
+         { "healed inputs", 1e-5, BOPAlgo_GlueOff,   true },
+      };
+      const int strategyCount = (int)(sizeof(strategies) / sizeof(strategies[0]));
+
+      std::atomic<bool> cancelled(false);
+      std::atomic<int> nextStrategy(0);
+      std::mutex winnerMutex;
+      std::unique_ptr<BRepAlgoAPI_Fuse> winner;
+      std::vector<std::string> failures;
+      auto fail = [&](const FuseStrategy& strategy, const char* message) {
+         std::lock_guard<std::mutex> lock(winnerMutex);
+         failures.push_back(std::string(strategy.name) + ": " + message);
+      };
+
+      auto worker = [&]() {
+         Handle(CancelIndicator) indicator = new CancelIndicator(cancelled);
+         for (int i = nextStrategy++; i < strategyCount && !cancelled; i = nextStrategy++) {
+            const FuseStrategy& strategy = strategies[i];
+            bool isGlue = strategy.glue != BOPAlgo_GlueOff;
+            if (isGlue && touchingShape2.IsNull())
+               continue;
+
+            try {
+               TopoDS_Shape argument = strategy.healInputs ? FixShape(CopyShape(shape1)) : shape1;
+               TopoDS_Shape tool = isGlue ? touchingShape2 : shape2;
+               if (strategy.healInputs)
+                  tool = FixShape(CopyShape(tool));
+
+               TopTools_ListOfShape arguments, tools;
+               arguments.Append(argument);
+               tools.Append(tool);
+
+               // The inputs are shared between the threads, they must not be modified
+               auto fuser = std::make_unique<BRepAlgoAPI_Fuse>();
+               fuser->SetArguments(arguments);
+               fuser->SetTools(tools);
+               fuser->SetFuzzyValue(strategy.fuzzyValue);
+               fuser->SetGlue(strategy.glue);
+               fuser->SetNonDestructive(Standard_True);
+               fuser->SetRunParallel(Standard_False);
+               fuser->Build(indicator->Start());
+               if (cancelled || !fuser->IsDone() || fuser->HasErrors() || !IsSingleSolid(fuser->Shape()))
+                  continue;
+
+               std::lock_guard<std::mutex> lock(winnerMutex);
+               if (!winner) {
+                  winner = std::move(fuser);
+                  cancelled = true;
+               }
+            }
+            catch (const Standard_Failure& ex) {
+               fail(strategy, ex.GetMessageString());
+            }
+            catch (const std::exception& ex) {
+               // Nothing may escape a thread, bad_alloc included: the strategy just loses
+               fail(strategy, ex.what());
+            }
+         }
+      };
+
+      // Every boolean runs single threaded, the parallelism is across the strategies
+      int threadCount = std::max(1, std::min(strategyCount, Concurrency::JobThreads()));
+      std::vector<std::thread> threads;
+      for (int i = 1; i < threadCount; ++i)
+         threads.emplace_back(worker);
+      worker();
+      for (std::thread& thread : threads)
+         thread.join();
+
+      rFailures.clear();
+      for (const std::string& failure : failures)
+         rFailures += (rFailures.empty() ? "" : "; ") + failure;
+      return winner;
+   }
+
+   // Joint-only variant of HandleIntersectingBoundingCurves. Sewing and same-domain
+   // unification see only the faces the fuse touched and their neighbours, so the
+   // cost follows the size of the joint and not the length of the rail. Falls back
+   // to the full pass when there is no history or the local result is not valid
+   static TopoDS_Shape RefineJoint(const TopoDS_Shape& shape, const TopTools_IndexedMapOfShape& jointFaces,
+      double tolerance) {
+      if (jointFaces.IsEmpty())
+         return HandleIntersectingBoundingCurves(shape, tolerance);
+
+      // Step 1: Sew the joint faces in the context of the whole shape
+      BRepBuilderAPI_Sewing sewing(tolerance);
+      sewing.Load(shape);
+      for (int i = 1; i <= jointFaces.Extent(); ++i)
+         sewing.Add(jointFaces(i));
+      sewing.Perform();
+      TopoDS_Shape sewedShape = sewing.SewedShape();
+      if (sewedShape.IsNull())
+         return HandleIntersectingBoundingCurves(shape, tolerance);
+
+      // Step 2: The region is the sewn joint faces plus their neighbours. Edges shared
+      // with faces outside the region are kept, so the untouched faces stay connected
+      TopTools_IndexedDataMapOfShapeListOfShape edgeFaces;
+      TopExp::MapShapesAndAncestors(sewedShape, TopAbs_EDGE, TopAbs_FACE, edgeFaces);
+
+      TopTools_IndexedMapOfShape region;
+      for (int i = 1; i <= jointFaces.Extent(); ++i) {
+         const TopoDS_Shape& face = sewing.Modified(jointFaces(i));
+         region.Add(face);
+         for (TopExp_Explorer edgeExp(face, TopAbs_EDGE); edgeExp.More(); edgeExp.Next())
+            if (edgeFaces.Contains(edgeExp.Current()))
+               for (const TopoDS_Shape& neighbour : edgeFaces.FindFromKey(edgeExp.Current()))
+                  region.Add(neighbour);
+      }
+
+      BRep_Builder builder;
+      TopoDS_Compound regionFaces;
+      builder.MakeCompound(regionFaces);
+      TopTools_MapOfShape borderEdges;
+      for (int i = 1; i <= region.Extent(); ++i) {
+         builder.Add(regionFaces, region(i));
+         for (TopExp_Explorer edgeExp(region(i), TopAbs_EDGE); edgeExp.More(); edgeExp.Next()) {
+            if (!edgeFaces.Contains(edgeExp.Current()))
+               continue;
+            for (const TopoDS_Shape& face : edgeFaces.FindFromKey(edgeExp.Current()))
+               if (!region.Contains(face))
+                  borderEdges.Add(edgeExp.Current());
+         }
+      }
+
+      // Step 3: Unify same-domain faces of the region only
+      ShapeUpgrade_UnifySameDomain unify(regionFaces, Standard_True, Standard_True, Standard_False);
+      unify.KeepShapes(borderEdges);
+      unify.Build();
+
+      // Step 4: Splice the unified faces back into the whole shape
+      Handle(BRepTools_History) history = unify.History();
+      Handle(ShapeBuild_ReShape) reShape = new ShapeBuild_ReShape();
+      TopTools_MapOfShape placed;
+      TopoDS_Compound refinedFaces;
+      builder.MakeCompound(refinedFaces);
+      for (int i = 1; i <= region.Extent(); ++i) {
+         const TopoDS_Shape& face = region(i);
+         if (history->IsRemoved(face)) {
+            reShape->Remove(face);
+            continue;
+         }
+
+         const TopTools_ListOfShape& modified = history->Modified(face);
+         if (modified.IsEmpty()) {
+            builder.Add(refinedFaces, face);
+            continue;
+         }
+
+         // A unified face replaces the first of its source faces, the others go away
+         TopoDS_Compound replacement;
+         builder.MakeCompound(replacement);
+         bool hasNewFace = false;
+         for (const TopoDS_Shape& newFace : modified) {
+            if (!placed.Add(newFace))
+               continue;
+            builder.Add(replacement, newFace);
+            builder.Add(refinedFaces, newFace);
+            hasNewFace = true;
+         }
+         if (hasNewFace)
+            reShape->Replace(face, replacement);
+         else
+            reShape->Remove(face);
+      }
+      TopoDS_Shape refinedShape = reShape->Apply(sewedShape);
+
+      // Only the refined region needs checking, the rest of the shape did not change
+      if (refinedShape.IsNull() || !OCCTUtils::IsShapeValid(refinedFaces))
+         return HandleIntersectingBoundingCurves(shape, tolerance);
+
+      return refinedShape;
+   }
+
+   enum class Verdict { Pass, Fail, Inconclusive };
+
+   // Cheap check of a join result against its inputs: one solid, the volume of the inputs kept,
+   // the centroid where their volumes put it and no more area than they had. A gross failure
+   // gives Fail, a near miss or an inner shell Inconclusive, left to the full analyzer. So does
+   // a result without a solid or with an open shell, their volume says nothing
+   static Verdict VerifyConservation(const TopoDS_Shape& shape1, const TopoDS_Shape& shape2,
+      const TopoDS_Shape& result, double tolerance, std::string& rReason) {
+      TopTools_IndexedMapOfShape solids, shells;
+      TopExp::MapShapes(result, TopAbs_SOLID, solids);
+      TopExp::MapShapes(result, TopAbs_SHELL, shells);
+      if (solids.IsEmpty()) {
+         rReason = "no solid in the result";
+         return Verdict::Inconclusive;
+      }
+      for (int i = 1; i <= shells.Extent(); ++i)
+         if (!BRep_Tool::IsClosed(shells(i))) {
+            rReason = "open shell in the result";
+            return Verdict::Inconclusive;
+         }
+
+      // Volumes and areas of the inputs and of the result, all at once
+      const TopoDS_Shape* shapes[3] = { &shape1, &shape2, &result };
+      GProp_GProps volumes[3], areas[3];
+      Concurrency::For(6, [&](int i) {
+         if (i < 3)
+            BRepGProp::VolumeProperties(*shapes[i], volumes[i]);
+         else
+            BRepGProp::SurfaceProperties(*shapes[i - 3], areas[i - 3]);
+      });
+
+      double inputVolume = volumes[0].Mass() + volumes[1].Mass();
+      double inputArea = areas[0].Mass() + areas[1].Mass();
+      if (inputVolume <= 0 || inputArea <= 0) {
+         rReason = "the inputs have no volume";
+         return Verdict::Inconclusive;
+      }
+      if (solids.Extent() > 1) {
+         rReason = std::to_string(solids.Extent()) + " solids in the result";
+         return Verdict::Fail;
+      }
+      gp_Pnt inputCentroid((volumes[0].CentreOfMass().XYZ() * volumes[0].Mass()
+         + volumes[1].CentreOfMass().XYZ() * volumes[1].Mass()) / inputVolume);
+      Bnd_Box box;
+      BRepBndLib::Add(result, box);
+      double size = box.IsVoid() ? 1 : std::sqrt(box.SquareExtent());
+
+      double volumeError = std::abs(volumes[2].Mass() - inputVolume) / inputVolume;
+      double centroidError = volumes[2].CentreOfMass().Distance(inputCentroid) / size;
+      double areaExcess = (areas[2].Mass() - inputArea) / inputArea;
+      std::ostringstream reason;
+      reason << "volume off by " << volumeError * 100 << "%, centroid by " << centroidError * 100
+         << "% of the size, area by " << areaExcess * 100 << "%";
+      rReason = reason.str();
+
+      if (volumes[2].Mass() <= 0 || volumeError > 10 * tolerance || centroidError > 10 * tolerance)
+         return Verdict::Fail;
+      if (shells.Extent() != 1 || volumeError > tolerance || centroidError > tolerance || areaExcess > tolerance)
+         return Verdict::Inconclusive;
+      return Verdict::Pass;
+   }
+
    static bool HasMultipleConnectedComponents(const TopoDS_Shape& shape) {
       int solidCount = 0;
 
@@ -358,17 +1938,61 @@ class IGESShapePimpl {
    private:
    TopoDS_Shape shapes[ShapeCount];
 
+   // Per-face bounding boxes of each slot, computed on demand and dropped when the slot changes
+   std::vector<FaceBox> faceBoxes[ShapeCount];
+
+   // Operation history. A step holds the three slots as they were before a command. A
+   // TopoDS_Shape is only a handle on the reference counted TShape, so a step shares the
+   // topology with the current shapes and costs three handles
+   struct HistoryStep {
+      std::string command;
+      TopoDS_Shape shapes[ShapeCount];
+      std::string keys[ShapeCount];
+   };
+   static constexpr std::size_t MaxHistorySteps = 32;
+   std::vector<HistoryStep> undoSteps;
+   std::vector<HistoryStep> redoSteps;
+
+   // Slots parked in BinTools form under memory pressure, restored on first access
+   std::string parkedShapes[ShapeCount];
+
+   // Content key of each part: the hash of its file followed by the commands applied to it.
+   // Empty when the part can not be traced back to a file, which disables the join cache
+   std::string shapeKeys[ShapeCount];
+   MemoryReport memoryReport;
+
+   // Parts still healing after a progressive load. The first access to the slot waits for them
+   std::future<LoadedPart> pendingParts[ShapeCount];
+
+   // Stages of budgeted joins that overran, winding down after their user break. The engine
+   // joins them when it goes
+   struct OverrunStage {
+      std::thread thread;
+      std::shared_ptr<std::atomic<bool>> finished;
+   };
+   static constexpr std::size_t MaxOverrunStages = 2;
+   std::vector<OverrunStage> overrunStages;
+
    Handle(Aspect_DisplayConnection) displayConnection;
    Handle(OpenGl_GraphicDriver) graphicDriver;
    Handle(V3d_Viewer) viewer; // Open CASCADE viewer
    Handle(V3d_View) view;
    Handle(WNT_Window) viewWindow;
    Handle(AIS_InteractiveContext) context; // AIS Context14
-   BRepAlgoAPI_Fuse fuser;
+   Handle(BRepTools_History) joinHistory; // Inputs to fused shape, kept after the fuser is gone
+   JoinOptions joinOptions;
+   LoadOptions loadOptions;
+   ExportOptions exportOptions;
+   ExportReport exportReport;
+   std::vector<FeatureRecord> features; // Table of the last feature recognition
 
    public:
    IGESShapePimpl() = default;
    ~IGESShapePimpl() {
+      // The overrun stages still read the parts, they are past their deadline and stop soon
+      for (OverrunStage& stage : this->overrunStages)
+         stage.thread.join();
+
       try {
          // Ensure OCCT handles are released before exiting
          context.Nullify();
@@ -377,80 +2001,319 @@ class IGESShapePimpl {
          displayConnection.Nullify();
          graphicDriver.Nullify();
 
-         // Clear fuser object
-         fuser = BRepAlgoAPI_Fuse(); // Reset to default
+         joinHistory.Nullify();
+
+         // Ensure all shapes are cleared
+         for (int i = 0; i < ShapeCount; i++)
+            shapes[i].Nullify();
+      }
+      catch (const std::exception& ex) {
+         std::cerr << "Exception in IGESShapePimpl destructor: " << ex.what() << std::endl;
+      }
+      catch (...) {
+         std::cerr << "Unknown exception in IGESShapePimpl destructor!" << std::endl;
+      }
+   }
+   explicit IGESShapePimpl(const Handle(V3d_Viewer)& aViewer) : viewer(aViewer) {}
+
+   void SetViewer(const Handle(V3d_Viewer)& viewer) {
+      this->viewer = viewer;
+   }
+
+   void SetView() {}
+
+   void SetDispObject(Handle(Aspect_DisplayConnection) displayConnection,
+      Handle(OpenGl_GraphicDriver) graphicDriver,
+      Handle(V3d_View)& view, Handle(WNT_Window) viewWindow) {
+      this->displayConnection = displayConnection;
+      this->graphicDriver = graphicDriver;
+      this->view = view;
+      this->viewWindow = viewWindow;
+   }
+
+   Handle(V3d_View) GetView() {
+      return this->view;
+   }
+
+   void SetContext(const Handle(AIS_InteractiveContext)& context) {
+      this->context = context;
+   }
+
+   Handle(V3d_Viewer) GetViewer() const {
+      return this->viewer;
+   }
+
+   Handle(AIS_InteractiveContext) GetContext() const {
+      return context;
+   }
+
+   V3d_ListOfView GetActiveViews() {
+      return this->viewer->ActiveViews();
+   }
+
+   void SetJoinHistory(const Handle(BRepTools_History)& history) {
+      this->joinHistory = history;
+   }
+
+   Handle(BRepTools_History) GetJoinHistory() const {
+      return this->joinHistory;
+   }
+
+   void SetJoinOptions(const JoinOptions& options) {
+      this->joinOptions = options;
+   }
+
+   const JoinOptions& GetJoinOptions() const {
+      return this->joinOptions;
+   }
+
+   // Join cache key of the parts in their slots, with every join option that changes the
+   // fused shape or whether it is accepted. False when the cache is off or a part has no key
+   bool JoinCacheKey(std::uint64_t& rKey) {
+      const JoinOptions& options = this->joinOptions;
+      const std::string& leftKey = this->GetShapeKey(ShapeType::Left);
+      const std::string& rightKey = this->GetShapeKey(ShapeType::Right);
+      if (!options.useCache || leftKey.empty() || rightKey.empty())
+         return false;
+      rKey = JoinCache::Hash(leftKey + "|" + rightKey);
+      rKey = JoinCache::Hash(std::string{ (char)options.localRefine, (char)options.speculativeFuse,
+         (char)options.glueJoin, (char)options.targetedHealing, (char)options.fastVerify }, rKey);
+      return true;
+   }
+
+   // Glue option of the parts placed in contact. Only the Y/Z profile of the end caps
+   // matters here, the cached boxes will do
+   BOPAlgo_GlueEnum ContactGlue() {
+      TopoDS_Compound leftEnd, rightEnd;
+      OCCTUtils::EndFaces(this->GetFaceBoxes(ShapeType::Left), true, 0.1, leftEnd);
+      OCCTUtils::EndFaces(this->GetFaceBoxes(ShapeType::Right), false, 0.1, rightEnd);
+      return OCCTUtils::ContactGlue(leftEnd, rightEnd, 0.1);
+   }
+
+   void SetLoadOptions(const LoadOptions& options) {
+      this->loadOptions = options;
+   }
+
+   const LoadOptions& GetLoadOptions() const {
+      return this->loadOptions;
+   }
+
+   void SetExportOptions(const ExportOptions& options) {
+      this->exportOptions = options;
+   }
+
+   const ExportOptions& GetExportOptions() const {
+      return this->exportOptions;
+   }
+
+   void SetExportReport(const ExportReport& report) {
+      this->exportReport = report;
+   }
+
+   const ExportReport& GetExportReport() const {
+      return this->exportReport;
+   }
+
+   void SetFeatures(std::vector<FeatureRecord> features) {
+      this->features = std::move(features);
+   }
+
+   const std::vector<FeatureRecord>& GetFeatures() const {
+      return this->features;
+   }
+
+   void SetShape(ShapeType index, const TopoDS_Shape& shape, const std::string& key = {}) {
+      assert(index >= ShapeType::Left && index <= ShapeType::Count);
+      if (this->pendingParts[(int)index].valid())
+         this->pendingParts[(int)index].wait();
+      this->pendingParts[(int)index] = {};
+      this->shapes[(int)index] = shape;
+      this->shapeKeys[(int)index] = key;
+      this->faceBoxes[(int)index].clear();
+      this->parkedShapes[(int)index].clear();
+   }
+
+   // The slot fills in when the healing finishes
+   void SetPendingShape(ShapeType index, std::future<LoadedPart> part) {
+      this->SetShape(index, TopoDS_Shape());
+      this->pendingParts[(int)index] = std::move(part);
+   }
+
+   // Hand over a stage of a budgeted join that overran its deadline. It winds down after its
+   // user break and sets finished at the end
+   void KeepOverrunStage(std::thread stage, std::shared_ptr<std::atomic<bool>> finished) {
+      this->overrunStages.push_back({ std::move(stage), std::move(finished) });
+   }
+
+   // Join the overrun stages that finished. While more than MaxOverrunStages still run, the
+   // oldest are waited for until the deadline. Returns the stages still running
+   int ReapOverrunStages(std::chrono::steady_clock::time_point deadline) {
+      for (;;) {
+         for (auto stage = this->overrunStages.begin(); stage != this->overrunStages.end();) {
+            if (!stage->finished->load()) {
+               ++stage;
+               continue;
+            }
+            stage->thread.join();
+            stage = this->overrunStages.erase(stage);
+         }
+         if (this->overrunStages.size() <= MaxOverrunStages || std::chrono::steady_clock::now() >= deadline)
+            return (int)this->overrunStages.size();
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+   }
+
+   bool IsPending(ShapeType index) const {
+      const std::future<LoadedPart>& part = this->pendingParts[(int)index];
+      return part.valid() && part.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+   }
+
+   // False when the part is still healing at the deadline
+   bool WaitPending(ShapeType index, std::chrono::steady_clock::time_point deadline) const {
+      const std::future<LoadedPart>& part = this->pendingParts[(int)index];
+      return !part.valid() || part.wait_until(deadline) == std::future_status::ready;
+   }
+
+   const std::string& GetShapeKey(ShapeType index) {
+      this->resolvePending(index);
+      return this->shapeKeys[(int)index];
+   }
+
+   // Key of the slot after one more command, empty if the slot has no key
+   std::string DerivedKey(ShapeType index, const std::string& command) {
+      const std::string& key = this->GetShapeKey(index);
+      return key.empty() ? key : key + ";" + command;
+   }
 
-         // Ensure all shapes are cleared
-         for (int i = 0; i < ShapeCount; i++)
-            shapes[i].Nullify();
-      }
-      catch (const std::exception& ex) {
-         std::cerr << "Exception in IGESShapePimpl destructor: " << ex.what() << std::endl;
+   TopoDS_Shape GetShape(ShapeType index) {
+      assert(index >= ShapeType::Left && index <= ShapeType::Count);
+      this->resolvePending(index);
+      if (this->IsParked(index)) {
+         std::istringstream stream(this->parkedShapes[(int)index], std::ios::binary);
+         BinTools::Read(this->shapes[(int)index], stream);
+         this->parkedShapes[(int)index].clear();
       }
-      catch (...) {
-         std::cerr << "Unknown exception in IGESShapePimpl destructor!" << std::endl;
+      return this->shapes[(int)index];
+   }
+
+   bool IsParked(ShapeType index) const {
+      return !this->parkedShapes[(int)index].empty();
+   }
+
+   // Serialize the idle Left/Right parts into compact in-memory buffers and drop their
+   // topology. The history steps would keep that topology alive, so they are dropped too
+   void ParkInputs() {
+      for (ShapeType index : { ShapeType::Left, ShapeType::Right }) {
+         this->resolvePending(index);
+         TopoDS_Shape& shape = this->shapes[(int)index];
+         if (shape.IsNull())
+            continue;
+         std::ostringstream stream(std::ios::binary);
+         BinTools::Write(shape, stream);
+         this->parkedShapes[(int)index] = stream.str();
+         shape.Nullify();
+         this->faceBoxes[(int)index].clear();
       }
+      this->undoSteps.clear();
+      this->redoSteps.clear();
    }
-   explicit IGESShapePimpl(const Handle(V3d_Viewer)& aViewer) : viewer(aViewer) {}
 
-   void SetViewer(const Handle(V3d_Viewer)& viewer) {
-      this->viewer = viewer;
+   // Estimated bytes held by each slot; a parked slot counts its buffer
+   std::size_t GetShapeBytes(ShapeType index) const {
+      if (this->IsParked(index))
+         return this->parkedShapes[(int)index].size();
+      return OCCTUtils::EstimateShapeBytes(this->shapes[(int)index]);
    }
 
-   void SetView() {}
+   MemoryReport& GetMemoryReport() {
+      return this->memoryReport;
+   }
 
-   void SetDispObject(Handle(Aspect_DisplayConnection) displayConnection,
-      Handle(OpenGl_GraphicDriver) graphicDriver,
-      Handle(V3d_View)& view, Handle(WNT_Window) viewWindow) {
-      this->displayConnection = displayConnection;
-      this->graphicDriver = graphicDriver;
-      this->view = view;
-      this->viewWindow = viewWindow;
+   const std::vector<FaceBox>& GetFaceBoxes(ShapeType index) {
+      assert(index >= ShapeType::Left && index <= ShapeType::Count);
+      this->resolvePending(index);
+      std::vector<FaceBox>& boxes = this->faceBoxes[(int)index];
+      if (boxes.empty() && !this->shapes[(int)index].IsNull())
+         boxes = OCCTUtils::ComputeFaceBoxes(this->shapes[(int)index]);
+      return boxes;
    }
 
-   Handle(V3d_View) GetView() {
-      return this->view;
+   void ClearJoinedShape() {
+      if (!this->shapes[(int)2].IsNull())
+         this->shapes[(int)2].Nullify();
+      this->faceBoxes[(int)2].clear();
+      this->joinHistory.Nullify();
    }
 
-   void SetContext(const Handle(AIS_InteractiveContext)& context) {
-      this->context = context;
+   // Record the slots before a command changes them. A new command drops the redo steps
+   void RecordStep(const std::string& command) {
+      this->undoSteps.push_back(this->captureStep(command));
+      if (this->undoSteps.size() > MaxHistorySteps)
+         this->undoSteps.erase(this->undoSteps.begin());
+      this->redoSteps.clear();
    }
 
-   Handle(V3d_Viewer) GetViewer() const {
-      return this->viewer;
+   bool UndoStep() {
+      if (this->undoSteps.empty())
+         return false;
+      this->redoSteps.push_back(this->captureStep(this->undoSteps.back().command));
+      this->restoreStep(this->undoSteps.back());
+      this->undoSteps.pop_back();
+      return true;
    }
 
-   Handle(AIS_InteractiveContext) GetContext() const {
-      return context;
+   bool RedoStep() {
+      if (this->redoSteps.empty())
+         return false;
+      this->undoSteps.push_back(this->captureStep(this->redoSteps.back().command));
+      this->restoreStep(this->redoSteps.back());
+      this->redoSteps.pop_back();
+      return true;
    }
 
-   V3d_ListOfView GetActiveViews() {
-      return this->viewer->ActiveViews();
+   // Put back the slots of a command that failed, the step is not offered for redo
+   void RevertStep() {
+      if (this->undoSteps.empty())
+         return;
+      this->restoreStep(this->undoSteps.back());
+      this->undoSteps.pop_back();
    }
 
-   void SetFuser(const BRepAlgoAPI_Fuse& fuser) {
-      this->fuser = fuser;
+   bool CanUndo() const {
+      return !this->undoSteps.empty();
    }
 
-   BRepAlgoAPI_Fuse GetFuser() {
-      return this->fuser;
+   bool CanRedo() const {
+      return !this->redoSteps.empty();
    }
 
-   void SetShape(ShapeType index, const TopoDS_Shape& shape) {
-      assert(index >= ShapeType::Left && index <= ShapeType::Count);
-      this->shapes[(int)index] = shape;
+   private:
+   void resolvePending(ShapeType index) {
+      std::future<LoadedPart>& pending = this->pendingParts[(int)index];
+      if (!pending.valid())
+         return;
+      LoadedPart part = pending.get();
+      this->shapes[(int)index] = part.shape;
+      this->shapeKeys[(int)index] = part.key;
+      this->memoryReport.sharedGeometryBytes[(int)index] = part.sharedBytes;
    }
 
-   TopoDS_Shape GetShape(ShapeType index) {
-      assert(index >= ShapeType::Left && index <= ShapeType::Count);
-      return this->shapes[(int)index];
+   HistoryStep captureStep(const std::string& command) {
+      HistoryStep step{ command };
+      for (int i = 0; i < ShapeCount; i++) {
+         step.shapes[i] = this->GetShape((ShapeType)i);
+         step.keys[i] = this->shapeKeys[i];
+      }
+      return step;
    }
 
-   void ClearJoinedShape() {
-      if (!this->shapes[(int)2].IsNull())
-         this->shapes[(int)2].Nullify();
+   void restoreStep(const HistoryStep& step) {
+      for (int i = 0; i < ShapeCount; i++)
+         this->SetShape((ShapeType)i, step.shapes[i], step.keys[i]);
    }
 
+   public:
+
    Bnd_Box GetBBox(const TopoDS_Shape& shape) {
       Bnd_Box bbox;
       BRepBndLib::Add(shape, bbox);
@@ -549,6 +2412,18 @@ void addOrReplaceShape_(Handle(AIS_InteractiveContext) context, IGESShapePimpl*
    // Clear existing shapes
    context->RemoveAll(true);
 
+   // With shared geometry, tessellate each repeated feature once at the display deflection
+   if (pShape->GetLoadOptions().shareGeometry) {
+      for (int i = 0; i < IGESShapePimpl::ShapeCount; i++) {
+         if (pShape->IsParked((IGESShapePimpl::ShapeType)i))
+            continue;
+         TopoDS_Shape shape = pShape->GetShape((IGESShapePimpl::ShapeType)i);
+         if (!shape.IsNull())
+            OCCTUtils::MeshInstanced(shape,
+               StdPrs_ToolTriangulatedShape::GetDeflection(shape, context->DefaultDrawer()));
+      }
+   }
+
    // Check priority: Fused shape (index 2) first
    TopoDS_Shape fusedShape = pShape->GetShape(IGESShapePimpl::ShapeType::Fused);
    if (!fusedShape.IsNull()) {
@@ -601,18 +2476,99 @@ void addOrReplaceShape_(Handle(AIS_InteractiveContext) context, IGESShapePimpl*
    view->Redraw();
 }
 
+// Progressive load: the bounding box of the part as soon as it is known, then the part
+// meshed coarsely. The next command that redisplays the parts replaces the preview
+void showPreview_(IGESShapePimpl* pShape, const TopoDS_Shape& shape) {
+   const double PreviewDeviation = 0.01; // Ten times the default deviation coefficient
+   auto context = pShape->GetContext();
+   auto view = pShape->GetView();
+   if (context.IsNull() || view.IsNull())
+      return;
+
+   Bnd_Box box;
+   BRepBndLib::Add(shape, box, Standard_False);
+   if (box.IsVoid())
+      return;
+   box.Enlarge(0.1); // Flat parts still make a solid box
+   Handle(AIS_Shape) aisBox = new AIS_Shape(BRepPrimAPI_MakeBox(box.CornerMin(), box.CornerMax()).Shape());
+   context->Display(aisBox, AIS_WireFrame, 0, Standard_False);
+   view->FitAll(0.01, Standard_False);
+   view->Redraw();
+
+   Handle(AIS_Shape) aisShape = new AIS_Shape(shape);
+   aisShape->SetOwnDeviationCoefficient(PreviewDeviation);
+   context->Display(aisShape, AIS_Shaded, 0, Standard_False);
+   context->Remove(aisBox, Standard_False);
+   view->Redraw();
+}
+
 // File handling
 int IGESNative::LoadIGES(const std::string& filePath, int pNo /*= 0*/) {
    g_Status.errorNo = IGESStatus::NoError;
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Load");
+
+   LoadOptions options = this->pShape->GetLoadOptions();
+   TopoDS_Shape shape;
+   {
+      std::lock_guard<std::mutex> lock(Concurrency::ExchangeMutex());
+      IGESControl_Reader reader;
+      bool read = options.fastReader && ReadIGESFast(filePath, reader);
+      if (!read && !reader.ReadFile(filePath.c_str()))
+         throw InputIGESFileCorruptException(filePath);
+
+      reader.TransferRoots();
+      shape = reader.OneShape();
+   }
 
-   IGESControl_Reader reader;
-   if (!reader.ReadFile(filePath.c_str()))
-      throw InputIGESFileCorruptException(filePath);
+   // Heal the part and key it for the join cache by the file content and the import options.
+   // The file is only read again for its hash when the join cache is on, a part loaded
+   // without a key is never read back from the cache
+   bool useCache = this->pShape->GetJoinOptions().useCache;
+   auto finish = [options, filePath, useCache](TopoDS_Shape shape) {
+      LoadedPart part;
+      if (options.canonicalGeometry)
+         shape = OCCTUtils::CanonicalizeGeometry(shape, options.canonicalTolerance);
+      part.shape = options.targetedHealing ? OCCTUtils::FixShapeTargeted(shape) : OCCTUtils::FixShape(shape);
+      if (options.shareGeometry)
+         part.sharedBytes = OCCTUtils::ShareRepeatedGeometry(part.shape, options.canonicalTolerance);
+
+      std::uint64_t fileHash = 0;
+      if (useCache && JoinCache::HashFile(filePath, fileHash)) {
+         part.key = JoinCache::ToHex(fileHash);
+         // Every import option that changes the healed part
+         if (options.canonicalGeometry)
+            part.key += ";canonical:" + std::to_string(options.canonicalTolerance);
+         if (options.shareGeometry)
+            part.key += ";share:" + std::to_string(options.canonicalTolerance);
+         if (options.targetedHealing)
+            part.key += ";targeted";
+         if (options.fastReader)
+            part.key += ";fastread";
+      }
+      return part;
+   };
 
-   reader.TransferRoots();
-   TopoDS_Shape shape = TopoDS_Shape(reader.OneShape());
-   shape = OCCTUtils::FixShape(shape);
-   this->pShape->SetShape((IGESShapePimpl::ShapeType)pNo, shape);
+   this->pShape->RecordStep("Load");
+   this->pShape->GetMemoryReport().sharedGeometryBytes[pNo] = 0;
+   if (options.progressiveLoad) {
+      // The preview meshes a copy of the topology, the healing works on the original
+      TopoDS_Shape preview = BRepBuilderAPI_Copy(shape, Standard_False, Standard_False).Shape();
+      this->pShape->SetPendingShape((IGESShapePimpl::ShapeType)pNo,
+         std::async(std::launch::async, [finish, shape]() {
+            try {
+               return finish(shape);
+            }
+            catch (const Standard_Failure&) {
+               return LoadedPart{ shape }; // Keep the part as transferred when the healing fails
+            }
+         }));
+      showPreview_(this->pShape, preview);
+   }
+   else {
+      LoadedPart part = finish(shape);
+      this->pShape->SetShape((IGESShapePimpl::ShapeType)pNo, part.shape, part.key);
+      this->pShape->GetMemoryReport().sharedGeometryBytes[pNo] = part.sharedBytes;
+   }
 
 
    /*auto viewer = pShape->GetViewer();
@@ -634,6 +2590,351 @@ int IGESNative::LoadIGES(const std::string& filePath, int pNo /*= 0*/) {
    return g_Status.errorNo;
 }
 
+int IGESNative::GenerateRails(const RailSpec& spec) {
+   g_Status.errorNo = IGESStatus::NoError;
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Generate");
+
+   TopoDS_Shape left, right;
+   try {
+      MakeRailPair(spec, left, right);
+   }
+   catch (const Standard_Failure& ex) {
+      return g_Status.SetError(IGESStatus::ShapeError, ex.GetMessageString());
+   }
+   catch (const std::exception& ex) {
+      return g_Status.SetError(IGESStatus::ShapeError, ex.what());
+   }
+
+   // Generated parts have no file behind them, so the join cache leaves them alone
+   this->pShape->RecordStep("Generate");
+   this->pShape->SetShape(IGESShapePimpl::ShapeType::Left, left);
+   this->pShape->SetShape(IGESShapePimpl::ShapeType::Right, right);
+   this->pShape->SetShape(IGESShapePimpl::ShapeType::Fused, TopoDS_Shape());
+   for (std::size_t& bytes : this->pShape->GetMemoryReport().sharedGeometryBytes)
+      bytes = 0;
+
+   auto context = this->pShape->GetContext();
+   if (!context.IsNull())
+      addOrReplaceShape_(context, this->pShape);
+   return g_Status.errorNo;
+}
+
+bool IGESNative::IsLoading(int shapeType) const {
+   return this->pShape->IsPending((IGESShapePimpl::ShapeType)shapeType);
+}
+
+// Write one shape, compacted first when the export options ask for it, and report it
+bool writeIGES_(IGESShapePimpl* pShape, TopoDS_Shape shape, const std::string& filePath) {
+   const ExportOptions& options = pShape->GetExportOptions();
+   ExportReport report;
+   if (options.compact)
+      shape = OCCTUtils::CompactForExport(shape, options.tolerance, report);
+
+   bool written = false;
+   {
+      std::lock_guard<std::mutex> lock(Concurrency::ExchangeMutex());
+      IGESControl_Writer writer;
+      writer.AddShape(shape);
+      report.entities = writer.Model()->NbEntities();
+      written = writer.Write(filePath.c_str());
+   }
+   if (written) {
+      std::error_code error;
+      std::uintmax_t size = std::filesystem::file_size(filePath, error);
+      report.fileBytes = error ? 0 : (std::size_t)size;
+   }
+   pShape->SetExportReport(report);
+   return written;
+}
+
+int IGESNative::ProjectViews(int shapeType, const ProjectionOptions& options, std::vector<ProjectedSegment>& rSegments) {
+   g_Status.errorNo = IGESStatus::NoError;
+   rSegments.clear();
+
+   TopoDS_Shape shape;
+   this->getShape(shape, shapeType);
+   if (shape.IsNull())
+      return g_Status.SetError(IGESStatus::ShapeError, "There is no shape to project");
+
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Project");
+   std::string error;
+   if (!ProjectShape(shape, options, rSegments, error)) {
+      std::string message = "Hidden line removal of the views failed";
+      if (!error.empty())
+         message += ": " + error;
+      return g_Status.SetError(IGESStatus::CalculationError, message.c_str());
+   }
+   return g_Status.errorNo;
+}
+
+int IGESNative::SaveDXF(const std::string& filePath, int shapeType, const ProjectionOptions& options) {
+   std::vector<ProjectedSegment> segments;
+   if (this->ProjectViews(shapeType, options, segments))
+      return g_Status.errorNo;
+
+   if (!WriteProjectionDXF(segments, filePath))
+      g_Status.SetError(IGESStatus::FileWriteFailed, "DXF File Write failed");
+   return g_Status.errorNo;
+}
+
+int IGESNative::SliceSections(int shapeType, const std::vector<double>& stations, const SliceOptions& options,
+   std::vector<double>& rBuffer) {
+   g_Status.errorNo = IGESStatus::NoError;
+   rBuffer.clear();
+
+   TopoDS_Shape shape;
+   this->getShape(shape, shapeType);
+   if (shape.IsNull())
+      return g_Status.SetError(IGESStatus::ShapeError, "There is no shape to slice");
+
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Slice");
+   std::string error;
+   bool sliced = stations.empty()
+      ? SliceShape(shape, EvenStations(shape, options.axis, options.evenStations), options, rBuffer, error)
+      : SliceShape(shape, stations, options, rBuffer, error);
+   if (!sliced) {
+      std::string message = "Sectioning the part failed";
+      if (!error.empty())
+         message += ": " + error;
+      return g_Status.SetError(IGESStatus::CalculationError, message.c_str());
+   }
+   return g_Status.errorNo;
+}
+
+int IGESNative::RecognizeFeatures(int shapeType, const FeatureOptions& options) {
+   g_Status.errorNo = IGESStatus::NoError;
+   this->pShape->SetFeatures({});
+
+   TopoDS_Shape shape;
+   this->getShape(shape, shapeType);
+   if (shape.IsNull())
+      return g_Status.SetError(IGESStatus::ShapeError, "There is no shape to recognize features on");
+
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Features");
+   int failedFaces = 0;
+   this->pShape->SetFeatures(::RecognizeFeatures(shape, options, failedFaces));
+   if (failedFaces > 0)
+      return g_Status.SetError(IGESStatus::CalculationError,
+         ("Feature recognition failed on " + std::to_string(failedFaces) + " faces").c_str());
+   return g_Status.errorNo;
+}
+
+const FeatureRecord* IGESNative::GetFeatures(int& rCount) const {
+   const std::vector<FeatureRecord>& features = this->pShape->GetFeatures();
+   rCount = (int)features.size();
+   return features.data();
+}
+
+// Every check runs on fresh engines, so the options of one do not leak into the next. A check
+// that throws fails with the message
+int IGESNative::SelfTest(const std::string& directory, std::string& rReport) {
+   g_Status.errorNo = IGESStatus::NoError;
+   rReport.clear();
+   const double VolumeTolerance = 1e-4; // Relative, above the error of the volume integration
+
+   int failed = 0;
+   auto report = [&](bool pass, const char* check, const std::string& detail) {
+      rReport += std::string(pass ? "PASS " : "FAIL ") + check + " " + detail + "\n";
+      failed += pass ? 0 : 1;
+   };
+   auto run = [&](const char* check, auto body) {
+      try {
+         body(check);
+      }
+      catch (const Standard_Failure& ex) {
+         report(false, check, ex.GetMessageString());
+      }
+      catch (const std::exception& ex) {
+         report(false, check, ex.what());
+      }
+   };
+   auto volume = [](const TopoDS_Shape& shape) {
+      GProp_GProps props;
+      BRepGProp::VolumeProperties(shape, props);
+      return props.Mass();
+   };
+   auto faceCount = [](const TopoDS_Shape& shape) {
+      TopTools_IndexedMapOfShape faces;
+      TopExp::MapShapes(shape, TopAbs_FACE, faces);
+      return faces.Extent();
+   };
+   auto percent = [](double fraction) {
+      std::ostringstream text;
+      text << fraction * 100 << "%";
+      return text.str();
+   };
+
+   // A short C channel pair with half of its holes on B-spline surfaces
+   RailSpec spec;
+   spec.length = 600;
+   spec.splineFraction = 0.5;
+   std::string left = (std::filesystem::path(directory) / "SelfTestLeft.igs").string();
+   std::string right = (std::filesystem::path(directory) / "SelfTestRight.igs").string();
+   if (!WriteRailPair(spec, left, right))
+      return g_Status.SetError(IGESStatus::FileWriteFailed, "Writing the self test rails failed");
+
+   // Canonical geometry and the shared hole geometry keep a valid part of the same volume
+   run("canonical", [&](const char* check) {
+      IGESNative plain, canonical;
+      LoadOptions options;
+      options.canonicalGeometry = true;
+      options.shareGeometry = true;
+      canonical.SetLoadOptions(options);
+      if (plain.LoadIGES(left, 0) || canonical.LoadIGES(left, 0))
+         return report(false, check, g_Status.error);
+      TopoDS_Shape before, after;
+      plain.getShape(before, 0);
+      canonical.getShape(after, 0);
+      bool valid = OCCTUtils::IsShapeValid(after);
+      double error = std::abs(volume(after) - volume(before)) / volume(before);
+      std::size_t shared = canonical.GetMemoryReport().sharedGeometryBytes[0];
+      report(valid && error < VolumeTolerance, check, std::string(valid ? "valid" : "invalid")
+         + ", volume off by " + percent(error) + ", " + std::to_string(shared) + " bytes shared");
+   });
+
+   // A join read back from the cache is the join a fresh engine makes
+   run("cache", [&](const char* check) {
+      IGESNative fresh, first, second;
+      JoinOptions options;
+      options.useCache = true;
+      first.SetJoinOptions(options);
+      second.SetJoinOptions(options);
+      if (fresh.LoadIGES(left, 0) || fresh.LoadIGES(right, 1) || fresh.UnionShapes())
+         return report(false, check, g_Status.error);
+      if (first.LoadIGES(left, 0) || first.LoadIGES(right, 1) || first.UnionShapes())
+         return report(false, check, g_Status.error);
+
+      // The second engine finds the entry of the first before it joins
+      std::uint64_t key = 0;
+      TopoDS_Shape entry;
+      if (second.LoadIGES(left, 0) || second.LoadIGES(right, 1))
+         return report(false, check, g_Status.error);
+      if (!second.pShape->JoinCacheKey(key) || !JoinCache::Shared().Find(key, entry))
+         return report(false, check, "the join was not cached");
+      if (second.UnionShapes())
+         return report(false, check, g_Status.error);
+      TopoDS_Shape joined, cached;
+      fresh.getShape(joined, 2);
+      second.getShape(cached, 2);
+      double error = std::abs(volume(cached) - volume(joined)) / volume(joined);
+      int faces = faceCount(cached), freshFaces = faceCount(joined);
+      report(error < VolumeTolerance && faces == freshFaces, check, "volume off by " + percent(error) + ", "
+         + std::to_string(faces) + " faces, fresh " + std::to_string(freshFaces));
+   });
+
+   // The preflight stops a yawed part before the fuse and names the yaw. The C channel is
+   // symmetric in Y and joins yawed, so one flange of each rail is cut down to a stub: the
+   // L section left meets its yawed self on the web alone
+   run("preflight", [&](const char* check) {
+      RailSpec angle;
+      angle.length = spec.length;
+      angle.flangeHeight = 150;
+      angle.cornerRadius = 0;
+      angle.holesPerMetre = 0;
+      TopoDS_Shape rails[2];
+      MakeRailPair(angle, rails[0], rails[1]);
+      IGESNative engine;
+      for (int i = 0; i < 2; i++) {
+         Bnd_Box box;
+         BRepBndLib::Add(rails[i], box);
+         double xmin, ymin, zmin, xmax, ymax, zmax;
+         box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+         double t = angle.thickness;
+         TopoDS_Shape flange = BRepPrimAPI_MakeBox(gp_Pnt(xmin - 1, ymin - 1, zmin + 2 * t),
+            gp_Pnt(xmax + 1, ymin + t + 1, zmax + 1)).Shape();
+         engine.pShape->SetShape((IGESShapePimpl::ShapeType)i, BRepAlgoAPI_Cut(rails[i], flange).Shape());
+      }
+      JoinOptions options;
+      options.preflight = true;
+      engine.SetJoinOptions(options);
+      engine.YawBy180(1);
+      try {
+         engine.UnionShapes();
+         report(false, check, "the yawed part was joined");
+      }
+      catch (const FuseFailureException& ex) {
+         std::string message = ex.what();
+         report(message.find("Yaw Part 2") != std::string::npos, check, message);
+      }
+   });
+
+   // Targeted healing, on load and after the fuse, gives a valid join of the volume the full
+   // healing gives
+   run("heal", [&](const char* check) {
+      IGESNative full, targeted;
+      LoadOptions loadOptions;
+      loadOptions.targetedHealing = true;
+      targeted.SetLoadOptions(loadOptions);
+      JoinOptions joinOptions;
+      joinOptions.targetedHealing = true;
+      targeted.SetJoinOptions(joinOptions);
+      if (full.LoadIGES(left, 0) || full.LoadIGES(right, 1) || full.UnionShapes())
+         return report(false, check, g_Status.error);
+      if (targeted.LoadIGES(left, 0) || targeted.LoadIGES(right, 1) || targeted.UnionShapes())
+         return report(false, check, g_Status.error);
+      TopoDS_Shape joined, healed;
+      full.getShape(joined, 2);
+      targeted.getShape(healed, 2);
+      bool valid = OCCTUtils::IsShapeValid(healed);
+      double error = std::abs(volume(healed) - volume(joined)) / volume(joined);
+      report(valid && error < VolumeTolerance, check,
+         std::string(valid ? "valid" : "invalid") + ", volume off by " + percent(error));
+   });
+
+   // The parallel front end fills the model ReadFile would
+   run("fastread", [&](const char* check) {
+      std::lock_guard<std::mutex> lock(Concurrency::ExchangeMutex());
+      IGESControl_Reader fast, plain;
+      if (!ReadIGESFast(left, fast) || !plain.ReadFile(left.c_str()))
+         return report(false, check, "the file was not read");
+      int entities = fast.Model()->NbEntities(), plainEntities = plain.Model()->NbEntities();
+      report(entities == plainEntities, check,
+         std::to_string(entities) + " entities, ReadFile " + std::to_string(plainEntities));
+   });
+
+   // A Pass of the fast verification is a result the full analyzer accepts. The rails are
+   // written in contact, so the join overlapped the right one by the 0.01 mm of JoinParts
+   run("verify", [&](const char* check) {
+      IGESNative engine;
+      if (engine.LoadIGES(left, 0) || engine.LoadIGES(right, 1) || engine.UnionShapes())
+         return report(false, check, g_Status.error);
+      TopoDS_Shape leftPart, rightPart, joined;
+      engine.getShape(leftPart, 0);
+      engine.getShape(rightPart, 1);
+      engine.getShape(joined, 2);
+      std::string reason;
+      OCCTUtils::Verdict verdict = OCCTUtils::VerifyConservation(leftPart,
+         OCCTUtils::TranslateAlongX(rightPart, -(spec.gap + 0.01)), joined, 1e-3, reason);
+      bool valid = OCCTUtils::IsShapeValid(joined) && !OCCTUtils::HasMultipleConnectedComponents(joined);
+      if (verdict == OCCTUtils::Verdict::Inconclusive)
+         return report(true, check, "inconclusive, left to the analyzer: " + reason);
+      bool pass = verdict == OCCTUtils::Verdict::Pass;
+      report(pass == valid, check, std::string(pass ? "Pass" : "Fail") + ", analyzer "
+         + (valid ? "valid" : "invalid") + ": " + reason);
+   });
+
+   // The feature table holds every hole the generator cut, once
+   run("features", [&](const char* check) {
+      IGESNative engine;
+      if (engine.LoadIGES(left, 0) || engine.RecognizeFeatures(0, FeatureOptions()))
+         return report(false, check, g_Status.error);
+      int count = 0;
+      const FeatureRecord* features = engine.GetFeatures(count);
+      int holes = (int)std::count_if(features, features + count,
+         [](const FeatureRecord& feature) { return feature.kind == (int)FeatureKind::Hole; });
+      int cut = (int)std::floor(spec.holesPerMetre * spec.length / 1000) * spec.holeRows;
+      report(holes == cut, check, std::to_string(holes) + " holes of " + std::to_string(cut));
+   });
+
+   std::error_code error;
+   std::filesystem::remove(left, error);
+   std::filesystem::remove(right, error);
+   if (failed > 0)
+      return g_Status.SetError(IGESStatus::CalculationError, (std::to_string(failed) + " self test checks failed").c_str());
+   g_Status.ClearError();
+   return g_Status.errorNo;
+}
+
 int IGESNative::SaveIGES(const std::string& filePath, int shapeType /*= 0*/)
 {
    g_Status.errorNo = IGESStatus::NoError;
@@ -641,9 +2942,7 @@ int IGESNative::SaveIGES(const std::string& filePath, int shapeType /*= 0*/)
    TopoDS_Shape shape = this->pShape->GetShape((IGESShapePimpl::ShapeType)shapeType);
    assert(!shape.IsNull());
 
-   IGESControl_Writer writer;
-   writer.AddShape(shape);
-   if (!writer.Write(filePath.c_str()))
+   if (!writeIGES_(this->pShape, shape, filePath))
       g_Status.SetError(IGESStatus::FileWriteFailed, "IGES File Write failed");
 
    return g_Status.errorNo;
@@ -667,10 +2966,7 @@ int IGESNative::SaveAsIGS(const std::string& filePath) {
       return g_Status.SetError(IGESStatus::FuseError, "Fused shape does not have exactly one connected component");
 
    // Write mFusedShape to an IGES file
-   IGESControl_Writer writer;
-   writer.AddShape(fusedShape);
-
-   if (!writer.Write(filePath.c_str()))
+   if (!writeIGES_(this->pShape, fusedShape, filePath))
       g_Status.SetError(IGESStatus::FileWriteFailed, "IGES File Write failed");
 
    // Successfully saved IGES file
@@ -686,11 +2982,91 @@ int IGESNative::getShape(TopoDS_Shape& shape, int shapeType) {
    return g_Status.errorNo;
 }
 
+void IGESNative::SetJoinOptions(const JoinOptions& options) {
+   this->pShape->SetJoinOptions(options);
+}
+
+JoinOptions IGESNative::GetJoinOptions() const {
+   return this->pShape->GetJoinOptions();
+}
+
+void IGESNative::SetLoadOptions(const LoadOptions& options) {
+   this->pShape->SetLoadOptions(options);
+}
+
+LoadOptions IGESNative::GetLoadOptions() const {
+   return this->pShape->GetLoadOptions();
+}
+
+void IGESNative::SetConcurrency(const ConcurrencyOptions& options) {
+   Concurrency::Set(options);
+}
+
+void IGESNative::SetExportOptions(const ExportOptions& options) {
+   this->pShape->SetExportOptions(options);
+}
+
+ExportOptions IGESNative::GetExportOptions() const {
+   return this->pShape->GetExportOptions();
+}
+
+ExportReport IGESNative::GetExportReport() const {
+   return this->pShape->GetExportReport();
+}
+
+ConcurrencyOptions IGESNative::GetConcurrency() {
+   return Concurrency::Get();
+}
+
 int IGESNative::UndoJoin() {
+   if (!pShape->GetShape(IGESShapePimpl::ShapeType::Fused).IsNull())
+      pShape->RecordStep("Undo join");
    pShape->ClearJoinedShape();
    return IGESStatus::NoError;
 }
 
+int IGESNative::Undo() {
+   g_Status.errorNo = IGESStatus::NoError;
+   if (!this->pShape->UndoStep())
+      return g_Status.SetError(IGESStatus::ShapeError, "Nothing to undo");
+
+   auto context = this->pShape->GetContext();
+   if (!context.IsNull())
+      addOrReplaceShape_(context, this->pShape);
+   return g_Status.errorNo;
+}
+
+int IGESNative::Redo() {
+   g_Status.errorNo = IGESStatus::NoError;
+   if (!this->pShape->RedoStep())
+      return g_Status.SetError(IGESStatus::ShapeError, "Nothing to redo");
+
+   auto context = this->pShape->GetContext();
+   if (!context.IsNull())
+      addOrReplaceShape_(context, this->pShape);
+   return g_Status.errorNo;
+}
+
+std::string IGESNative::GetErrorMessage() const {
+   return g_Status.error;
+}
+
+MemoryReport IGESNative::GetMemoryReport() {
+   MemoryReport report = this->pShape->GetMemoryReport();
+   for (int i = 0; i < IGESShapePimpl::ShapeCount; i++)
+      report.slotBytes[i] = this->pShape->GetShapeBytes((IGESShapePimpl::ShapeType)i);
+   ProcessMemory(report.workingSet, report.peakWorkingSet);
+   return report;
+}
+
+bool IGESNative::CanUndo() const {
+   return this->pShape->CanUndo();
+}
+
+bool IGESNative::CanRedo() const {
+   return this->pShape->CanRedo();
+}
+
 // Geometry Process
 int IGESNative::AlignToXYPlane(int pNo /*= 0*/) {
    TopoDS_Shape shape;
@@ -699,6 +3075,8 @@ int IGESNative::AlignToXYPlane(int pNo /*= 0*/) {
       g_Status.SetError(IGESStatus::ShapeError, "No shape to align");
       return g_Status.errorNo;
    }
+   this->pShape->RecordStep("Align");
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Align");
 
    double xmin, ymin, zmin, xmax, ymax, zmax;
    std::tie(xmin, ymin, zmin, xmax, ymax, zmax) = this->pShape->GetBBoxComp(shape);
@@ -760,7 +3138,8 @@ int IGESNative::AlignToXYPlane(int pNo /*= 0*/) {
       OCCTUtils::ScrewRotationAboutMidPart(shape, fromPt, xAxis, 180);
    }
 
-   this->pShape->SetShape((IGESShapePimpl::ShapeType)pNo, shape);
+   this->pShape->SetShape((IGESShapePimpl::ShapeType)pNo, shape,
+      this->pShape->DerivedKey((IGESShapePimpl::ShapeType)pNo, "align"));
 
    // Translate the second part
    TopoDS_Shape part1Shape, part2Shape;
@@ -780,7 +3159,8 @@ int IGESNative::AlignToXYPlane(int pNo /*= 0*/) {
       // Apply the transformation to the shape
       BRepBuilderAPI_Transform shapeTransformer(part2Shape, translation, Standard_True); // Standard_True for copying the shape
       part2Shape = shapeTransformer.Shape(); // Update the shape with the transformed shape
-      this->pShape->SetShape((IGESShapePimpl::ShapeType::Right), part2Shape);
+      this->pShape->SetShape((IGESShapePimpl::ShapeType::Right), part2Shape,
+         this->pShape->DerivedKey(IGESShapePimpl::ShapeType::Right, "move:" + std::to_string(translationX)));
    }
 
    auto viewer = pShape->GetViewer();
@@ -795,7 +3175,23 @@ int IGESNative::RotatePartBy180AboutZAxis(int shapeType) {
    return 0;
 }
 
+// A join that throws or fails leaves the parts as they were, as MirrorJoin does
 int IGESNative::UnionShapes() {
+   this->pShape->RecordStep("Join");
+   int errorNo = IGESStatus::NoError;
+   try {
+      errorNo = this->unionShapes();
+   }
+   catch (...) {
+      this->pShape->RevertStep();
+      throw;
+   }
+   if (errorNo != IGESStatus::NoError)
+      this->pShape->RevertStep();
+   return errorNo;
+}
+
+int IGESNative::unionShapes() {
    g_Status.errorNo = IGESStatus::NoError;
 
    TopoDS_Shape leftShape;
@@ -810,84 +3206,296 @@ int IGESNative::UnionShapes() {
    if (rightShape.IsNull())
       throw NoPartLoadedException(1);
 
-   auto d = OCCTUtils::EdgeMidpointDistance(leftShape, rightShape);
-   TopoDS_Shape translatedRightShape = OCCTUtils::TranslateAlongX(rightShape, -(d + 0.01)); // Translate by -1.0 mm along X-axis
+   // Parts that can not meet are rejected before minutes of fusing
+   if (this->pShape->GetJoinOptions().preflight) {
+      JoinCheck check;
+      this->CheckJoin(check);
+      if (!check.contact) {
+         std::string message = "The end faces of the parts do not meet in a single contact patch.";
+         if (!check.suggestion.empty())
+            message += " " + check.suggestion + " and join again.";
+         g_Status.SetError(IGESStatus::ShapeError, message.c_str());
+         throw FuseFailureException(message);
+      }
+   }
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Join");
+   const JoinOptions& options = this->pShape->GetJoinOptions();
+
+   // A join of the same part revisions, placed by the same commands, is read back
+   std::uint64_t cacheKey = 0;
+   bool cacheable = this->pShape->JoinCacheKey(cacheKey);
+   TopoDS_Shape cachedShape;
+   if (cacheable && JoinCache::Shared().Find(cacheKey, cachedShape)) {
+      this->pShape->SetJoinHistory(Handle(BRepTools_History)());
+      this->pShape->SetShape(IGESShapePimpl::ShapeType::Fused, cachedShape);
+      if (options.parkInputs)
+         this->pShape->ParkInputs();
+      return g_Status.errorNo;
+   }
 
-   // Perform the initial union operation
-   BRepAlgoAPI_Fuse fuser(leftShape, translatedRightShape);
-   fuser.Build();
+   // Exact X gap between the facing end caps. Parts without a planar end cap fall
+   // back to the edge midpoint estimate
+   OCCTUtils::JoinInputs inputs;
+   inputs.left = leftShape;
+   inputs.right = rightShape;
+   inputs.exactGap = OCCTUtils::ContactGapX(this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Left),
+      this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Right), inputs.gap);
+   if (!inputs.exactGap) {
+      JobArena arena;
+      inputs.gap = OCCTUtils::EdgeMidpointDistance(leftShape, rightShape, arena.Scratch());
+   }
+   if (options.glueJoin && inputs.exactGap)
+      inputs.glue = this->pShape->ContactGlue();
+   OCCTUtils::JoinResult result = OCCTUtils::JoinParts(inputs, options);
 
-   TopoDS_Shape fusedShape;
+   // Store the fused shape and the history of the join in the handler
+   TopoDS_Shape fusedShape = result.shape;
+   if (!fusedShape.IsNull()) {
+      this->pShape->SetJoinHistory(result.history);
+      this->pShape->SetShape(IGESShapePimpl::ShapeType::Fused, fusedShape);
+   }
+   if (!result.error.empty())
+      return g_Status.SetError(IGESStatus::FuseError, result.error.c_str());
 
-   // Retrieve the initial fused shape
-   fusedShape = fuser.Shape();
+   if (cacheable)
+      JoinCache::Shared().Store(cacheKey, fusedShape);
 
-   // Validate the fuse operation
-   if (!fuser.IsDone() || fusedShape.IsNull())
-   {
-      // Try fusion once again
-      fusedShape = OCCTUtils::MergeShapesAlongX(leftShape, translatedRightShape);
-      if (fusedShape.IsNull())
-         throw FuseFailureException("Fusing input parts failed");
-      fusedShape = OCCTUtils::FixShape(fusedShape);
-      if (fusedShape.IsNull())
-         throw FuseFailureException("Fusing input parts failed");
-   }
-   else
-      fusedShape = OCCTUtils::FixShape(fusedShape);
+   // The parts stay idle until the join is undone
+   if (options.parkInputs)
+      this->pShape->ParkInputs();
 
-   pShape->SetShape(IGESShapePimpl::ShapeType::Fused, fusedShape);
+   return g_Status.errorNo;
+}
 
-   // Call the function to handle intersecting bounding curves
-   double tolerance = 1e-1; // Adjust the tolerance as needed
-   fusedShape = OCCTUtils::HandleIntersectingBoundingCurves(fusedShape, tolerance);
+// The join within a time budget. The join pipeline of UnionShapes, the same pipeline gluing
+// the parts in contact and a compound of the parts placed in contact are tried in turn, each
+// against its own deadline. A stage that overruns gets its user break and is handed to the
+// engine to wind down while the next, cheaper one runs
+int IGESNative::BudgetedJoin(double budgetSeconds, JoinBudgetReport& rReport) {
+   using Clock = std::chrono::steady_clock;
+   g_Status.errorNo = IGESStatus::NoError;
+   auto start = Clock::now();
+   auto budget = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::max(0.0, budgetSeconds)));
+   // Kept for the compound and the bookkeeping at the end
+   auto end = start + budget - std::min<Clock::duration>(std::chrono::seconds(1), budget / 20);
+   rReport = JoinBudgetReport();
+   rReport.budget = budgetSeconds;
+
+   // Stages that earlier joins left winding down take cores from this one. Beyond a few,
+   // the oldest are waited for, for at most a fifth of the budget
+   this->pShape->ReapOverrunStages(start + budget / 5);
+
+   // A part still healing is waited for only as long as the budget lasts
+   for (IGESShapePimpl::ShapeType index : { IGESShapePimpl::ShapeType::Left, IGESShapePimpl::ShapeType::Right })
+      if (!this->pShape->WaitPending(index, end))
+         return g_Status.SetError(IGESStatus::ShapeError, "The parts were still loading when the join budget ran out");
 
-   // Check for multiple connected components
-   TopTools_IndexedMapOfShape solids;
-   TopExp::MapShapes(fusedShape, TopAbs_SOLID, solids);
+   TopoDS_Shape leftShape;
+   this->getShape(leftShape, (int)IGESShapePimpl::ShapeType::Left);
+   TopoDS_Shape rightShape;
+   this->getShape(rightShape, (int)IGESShapePimpl::ShapeType::Right);
+   if (leftShape.IsNull() || rightShape.IsNull())
+      throw NoPartLoadedException(leftShape.IsNull() ? (rightShape.IsNull() ? 2 : 0) : 1);
+
+   this->pShape->RecordStep("Join");
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Join");
+   const JoinOptions& options = this->pShape->GetJoinOptions();
+
+   // Run the task on a thread of its own until the deadline. A task that overruns is handed
+   // to the engine, which joins it once it has wound down
+   auto runUntil = [this](Clock::time_point deadline, auto task, auto& rResult) {
+      using Result = std::decay_t<decltype(rResult)>;
+      auto promise = std::make_shared<std::promise<Result>>();
+      auto finished = std::make_shared<std::atomic<bool>>(false);
+      std::future<Result> result = promise->get_future();
+      std::thread thread([task, promise, finished]() {
+         promise->set_value(task());
+         *finished = true;
+      });
+      if (result.wait_until(deadline) != std::future_status::ready) {
+         this->pShape->KeepOverrunStage(std::move(thread), finished);
+         return false;
+      }
+      rResult = result.get();
+      thread.join();
+      return true;
+   };
 
-   // If there's more than one solid, merge them
-   if (solids.Extent() > 1) {
+   // A stage gives the join or a line in the report on why it did not
+   auto runStage = [&](const char* name, Clock::time_point deadline, const OCCTUtils::JoinInputs& inputs) {
+      auto stageStart = Clock::now();
+      Handle(DeadlineIndicator) indicator = new DeadlineIndicator(deadline);
+      JoinOptions stageOptions = options;
+      OCCTUtils::JoinResult result;
+      bool finished = runUntil(deadline, [inputs, stageOptions, indicator]() {
+         OCCTUtils::JoinResult result;
+         try {
+            result = OCCTUtils::JoinParts(inputs, stageOptions, indicator);
+         }
+         catch (const Standard_Failure& ex) {
+            result.error = ex.GetMessageString();
+         }
+         catch (const std::exception& ex) {
+            result.error = ex.what();
+         }
+         return result;
+      }, result);
+
+      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - stageStart).count();
+      rReport.stages += std::string(name) + " " + std::to_string(ms);
+      if (!finished)
+         rReport.stages += " timeout\n";
+      else if (!result.error.empty())
+         rReport.stages += " failed " + result.error + "\n";
+      else
+         rReport.stages += " done\n";
+      return finished && result.error.empty() ? result : OCCTUtils::JoinResult();
+   };
 
-      // Start with the first solid
-      TopoDS_Shape unifiedSolid = solids(1);
+   // A join of the same part revisions, placed by the same commands, is read back
+   std::uint64_t cacheKey = 0;
+   bool cacheable = this->pShape->JoinCacheKey(cacheKey);
+   OCCTUtils::JoinResult joined;
+   if (cacheable && JoinCache::Shared().Find(cacheKey, joined.shape)) {
+      rReport.stages += "cache 0 done\n";
+      rReport.path = JoinBudgetReport::Full;
+   }
 
-      // Iteratively fuse the remaining solids
-      for (int i = 2; i <= solids.Extent(); ++i) {
-         BRepAlgoAPI_Fuse iterativeFuser(unifiedSolid, solids(i));
-         iterativeFuser.Build();
+   // Without an exact contact the edge midpoint distance walks every edge of both parts.
+   // It gets a tenth of the budget, then the gap of the part boxes stands in
+   OCCTUtils::JoinInputs inputs;
+   inputs.left = leftShape;
+   inputs.right = rightShape;
+   inputs.exactGap = OCCTUtils::ContactGapX(this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Left),
+      this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Right), inputs.gap);
+   if (joined.shape.IsNull() && !inputs.exactGap) {
+      auto gapStart = Clock::now();
+      std::pair<double, std::string> gap;
+      bool measured = runUntil(gapStart + (end - gapStart) / 10, [leftShape, rightShape]() {
+         std::pair<double, std::string> gap(0, std::string());
+         try {
+            JobArena arena;
+            gap.first = OCCTUtils::EdgeMidpointDistance(leftShape, rightShape, arena.Scratch());
+         }
+         catch (const Standard_Failure& ex) {
+            gap.second = ex.GetMessageString();
+         }
+         catch (const std::exception& ex) {
+            gap.second = ex.what();
+         }
+         return gap;
+      }, gap) && gap.second.empty();
+      if (!measured)
+         inputs.gap = OCCTUtils::BoxGapX(this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Left),
+            this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Right));
+      else
+         inputs.gap = gap.first;
+      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - gapStart).count();
+      rReport.stages += "gap " + std::to_string(ms) + (measured ? " done" : " boxes")
+         + (gap.second.empty() ? "" : " " + gap.second) + "\n";
+   }
+   if (inputs.exactGap)
+      inputs.glue = this->pShape->ContactGlue();
+
+   // The glue join needs the parts exactly in contact. When it can run, the full join gets
+   // two thirds of the time left and the glue join the rest
+   if (joined.shape.IsNull()) {
+      joined = runStage("full", inputs.exactGap ? Clock::now() + (end - Clock::now()) * 2 / 3 : end, inputs);
+      rReport.path = JoinBudgetReport::Full;
+      if (!joined.shape.IsNull() && cacheable)
+         JoinCache::Shared().Store(cacheKey, joined.shape);
+   }
 
-         if (!iterativeFuser.IsDone())
-            return g_Status.SetError(IGESStatus::FuseError, "Iterative union operation failed");
+   if (joined.shape.IsNull() && inputs.exactGap) {
+      inputs.glueOnly = true;
+      joined = runStage("glue", end, inputs);
+      rReport.path = JoinBudgetReport::Glue;
+   }
+   else if (joined.shape.IsNull())
+      rReport.stages += "glue 0 skipped\n";
 
-         unifiedSolid = iterativeFuser.Shape();
-      }
+   // The parts side by side, in contact, as one compound. Moving the location takes no time
+   if (joined.shape.IsNull()) {
+      gp_Trsf transform;
+      transform.SetTranslation(gp_Vec(-inputs.gap, 0, 0));
+      BRep_Builder builder;
+      TopoDS_Compound compound;
+      builder.MakeCompound(compound);
+      builder.Add(compound, leftShape);
+      builder.Add(compound, rightShape.Moved(TopLoc_Location(transform)));
+      joined.shape = compound;
+      rReport.stages += "compound 0 done\n";
+      rReport.path = JoinBudgetReport::Compound;
+   }
 
-      // Update the fused shape to the unified result
-      fusedShape = unifiedSolid;
+   this->pShape->SetJoinHistory(joined.history);
+   this->pShape->SetShape(IGESShapePimpl::ShapeType::Fused, joined.shape);
+
+   // Parking serializes both parts, it is left out when the stages used up their time
+   if (options.parkInputs) {
+      auto parkStart = Clock::now();
+      bool park = parkStart < end;
+      if (park)
+         this->pShape->ParkInputs();
+      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - parkStart).count();
+      rReport.stages += "park " + std::to_string(ms) + (park ? " done\n" : " skipped\n");
    }
 
-   // Store the final fused shape and fuser in the handler
-   this->pShape->SetFuser(fuser); // Optionally store the last fuser
-   this->pShape->SetShape(IGESShapePimpl::ShapeType::Fused, fusedShape);
+   rReport.overrunStages = this->pShape->ReapOverrunStages(Clock::now());
+   rReport.elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+   return g_Status.errorNo;
+}
 
-   // Optional: Validate the final fused shape
-   BRepCheck_Analyzer analyzer(fusedShape);
-   if (!analyzer.IsValid())
-      return g_Status.SetError(IGESStatus::FuseError, "Final fused shape is invalid");
+int IGESNative::CheckJoin(JoinCheck& rCheck) {
+   g_Status.errorNo = IGESStatus::NoError;
 
-   if (OCCTUtils::HasMultipleConnectedComponents(fusedShape))
-      return g_Status.SetError(IGESStatus::FuseError, "Fused shape contains multiple connected components");
+   TopoDS_Shape leftShape, rightShape;
+   this->getShape(leftShape, (int)IGESShapePimpl::ShapeType::Left);
+   this->getShape(rightShape, (int)IGESShapePimpl::ShapeType::Right);
+   if (leftShape.IsNull() || rightShape.IsNull())
+      throw NoPartLoadedException(leftShape.IsNull() ? (rightShape.IsNull() ? 2 : 0) : 1);
 
+   rCheck = OCCTUtils::CheckContact(this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Left),
+      this->pShape->GetFaceBoxes(IGESShapePimpl::ShapeType::Right), rightShape);
    return g_Status.errorNo;
 }
 
-int IGESNative::mirror(TopoDS_Shape leftShape) {
-   // Compute the bounding box of the left shape
-   auto [xmin, ymin, zmin, xmax, ymax, zmax] = this->pShape->GetBBoxComp(leftShape);
+int IGESNative::MirrorJoin(int pNo /*= 0*/) {
+   g_Status.errorNo = IGESStatus::NoError;
+   if (pNo != (int)IGESShapePimpl::ShapeType::Left && pNo != (int)IGESShapePimpl::ShapeType::Right)
+      return g_Status.SetError(IGESStatus::ShapeError, "Only Part 1 or Part 2 can be mirrored");
+
+   TopoDS_Shape shape;
+   this->getShape(shape, pNo);
+   if (shape.IsNull())
+      throw NoPartLoadedException(pNo);
+
+   // The other half is derived from the loaded one, it is never read from a file.
+   // Mirror and join are one step, a failed join puts the slots back as they were
+   this->pShape->RecordStep("Mirror join");
+   int errorNo = IGESStatus::NoError;
+   try {
+      errorNo = this->mirror(shape, pNo);
+      if (errorNo == IGESStatus::NoError)
+         errorNo = this->unionShapes();
+   } catch (...) {
+      this->pShape->RevertStep();
+      throw;
+   }
+   if (errorNo != IGESStatus::NoError)
+      this->pShape->RevertStep();
+   return errorNo;
+}
+
+int IGESNative::mirror(const TopoDS_Shape& shape, int pNo) {
+   // Compute the bounding box of the source shape
+   auto [xmin, ymin, zmin, xmax, ymax, zmax] = this->pShape->GetBBoxComp(shape);
 
-   // Define the mirror plane passing through (xmax, ymax, zmax) with normal (-1, 0, 0)
-   gp_Pnt planePoint(xmax, ymax, zmax);
+   // The symmetry plane is the YZ plane at the joining end: Xmax of the left part,
+   // Xmin of the right part. The mirrored half is placed exactly in contact and
+   // UnionShapes takes care of the overlap needed for the fuse
+   bool isLeft = pNo == (int)IGESShapePimpl::ShapeType::Left;
+   gp_Pnt planePoint(isLeft ? xmax : xmin, ymax, zmax);
    gp_Dir planeNormal(-1, 0, 0);
    gp_Ax2 mirrorPlane(planePoint, planeNormal);
 
@@ -895,17 +3503,19 @@ int IGESNative::mirror(TopoDS_Shape leftShape) {
    gp_Trsf mirrorTransformation;
    mirrorTransformation.SetMirror(mirrorPlane);
 
-   // Apply the mirroring transformation to the left shape
-   BRepBuilderAPI_Transform mirroringTransform(leftShape, mirrorTransformation, true);
+   // Do not deep copy the source. A mirror can not be carried by a TopLoc_Location,
+   // so the geometry is transformed, but no BRepBuilderAPI_Copy of the part is made
+   BRepBuilderAPI_Transform mirroringTransform(shape, mirrorTransformation, Standard_False);
    TopoDS_Shape mirroredShape = mirroringTransform.Shape();
 
    if (mirroredShape.IsNull())
       return g_Status.SetError(IGESStatus::FuseError, "Failed to create mirrored shape");
 
-   mirroredShape = this->pShape->TranslateAlongX(mirroredShape, -0.9);
-
-   // Store the mirrored shape
-   this->pShape->SetShape(IGESShapePimpl::ShapeType::Fused, mirroredShape);
+   // Store the mirrored shape as the other part, any earlier join is void now
+   auto otherType = isLeft ? IGESShapePimpl::ShapeType::Right : IGESShapePimpl::ShapeType::Left;
+   this->pShape->SetShape(otherType, mirroredShape,
+      this->pShape->DerivedKey((IGESShapePimpl::ShapeType)pNo, "mirror"));
+   this->pShape->ClearJoinedShape();
 
    return g_Status.errorNo;
 }
@@ -1100,10 +3710,14 @@ int IGESNative::RotatePartByAxis(int shapeType, double deg, EAxis axis) {
    if (shape.IsNull())
       throw NoPartLoadedException(shapeType);
 
+   this->pShape->RecordStep("Rotate");
+   OperationMemoryScope memoryScope(this->pShape->GetMemoryReport(), "Rotate");
    RotatePartByAxis(shape, 180, axis);
-   this->pShape->SetShape((IGESShapePimpl::ShapeType)shapeType, shape);
+   this->pShape->SetShape((IGESShapePimpl::ShapeType)shapeType, shape,
+      this->pShape->DerivedKey((IGESShapePimpl::ShapeType)shapeType, "rotate:" + std::to_string((int)axis)));
    auto context = this->pShape->GetContext();
-   addOrReplaceShape_(context, this->pShape);
+   if (!context.IsNull())
+      addOrReplaceShape_(context, this->pShape);
    return 0;
 }
 
@@ -12,6 +12,12 @@ class TCollection_AsciiString;
 class IGESShapePimpl;
 class gp_Pnt;
 class gp_Dir;
+struct RailSpec;
+struct ProjectionOptions;
+struct ProjectedSegment;
+struct SliceOptions;
+struct FeatureOptions;
+struct FeatureRecord;
 
 // Specialized Exceptions
 class NoPartLoadedException : public std::exception {
@@ -93,7 +99,94 @@ class IGESStatus {
    }
 };
 
+// Native code keeps one status per thread so that engines driven from service workers
+// do not report each other's errors. The managed wrapper reads it through GetErrorMessage
+#ifdef _M_CEE
 static IGESStatus g_Status;
+#else
+static thread_local IGESStatus g_Status;
+#endif
+
+// Tuning of the join pipeline. The defaults keep the original UnionShapes behaviour
+struct JoinOptions {
+   bool localRefine = false;     // Sew and unify only the faces the fuse touched
+   bool speculativeFuse = false; // Race several fuse strategies on the spare cores
+   bool glueJoin = false;        // Join the parts in exact contact with the BOP glue option
+   // Memory pressure: keep the joined parts serialized in memory. The undo and redo
+   // history is dropped when the parts are parked, a parked join can not be undone
+   bool parkInputs = false;
+   bool useCache = false;        // Read repeated joins back from the on-disk join cache
+   bool preflight = false;       // Reject parts whose end caps do not meet before fusing
+   bool targetedHealing = false; // Heal only the faces the analyzer reports after the fuse
+   bool fastVerify = false;      // Check the result on mass properties first, the full analyzer only when in doubt
+};
+
+// Outcome of the join pre-flight, see IGESNative::CheckJoin
+struct JoinCheck {
+   static constexpr double MinOverlap = 0.6;
+
+   bool checked = false;    // False when the end caps could not be found, nothing is known
+   bool contact = true;     // The end caps meet in a single patch
+   double overlap = 0;      // Overlap of the end cap silhouettes seen along X, 0 to 1
+   int patches = 0;         // Connected patches of the overlap
+   std::string suggestion;  // Rotation likely missing, empty if none
+};
+
+// Outcome of a time-budgeted join, see IGESNative::BudgetedJoin
+struct JoinBudgetReport {
+   enum Path { None, Full, Glue, Compound };
+   Path path = None;      // Strategy whose result is in the Fused slot
+   double budget = 0;     // Seconds allowed
+   double elapsed = 0;    // Seconds taken
+   std::string stages;    // One line per stage tried: <stage> <ms> done|failed|timeout|skipped|boxes [reason]
+   int overrunStages = 0; // Stages of this and earlier joins that overran, still winding down on return
+};
+
+// Tuning of the IGES import. The defaults keep the original LoadIGES behaviour
+struct LoadOptions {
+   bool canonicalGeometry = false;    // Replace splines that are really planes, cylinders.. by analytic geometry
+   double canonicalTolerance = 1e-3;  // Max deviation accepted when recognizing or matching geometry
+   bool shareGeometry = false;        // Share the surfaces and curves of repeated holes and slots
+   bool targetedHealing = false;      // Heal only the faces the analyzer reports
+   bool fastReader = false;           // Parse the file mapped and in parallel, see ReadIGESFast
+   bool progressiveLoad = false;      // Show a coarse preview at once and heal in the background
+};
+
+// Optimization of the written model. The defaults keep the original SaveIGES behaviour
+struct ExportOptions {
+   bool compact = false;     // Merge same-domain faces, make splines analytic, share vertices, drop unused pcurves
+   double tolerance = 1e-3;  // Max deviation accepted when merging or converting
+};
+
+// Outcome of the last SaveIGES or SaveAsIGS
+struct ExportReport {
+   bool compacted = false;                   // False when the shape was written as is
+   int faces[2] = {};                        // Before and after the compaction
+   int edges[2] = {};
+   int vertices[2] = {};
+   std::size_t shapeBytes[2] = {};           // Estimated size of the model in memory
+   int entities = 0;                         // IGES entities written
+   std::size_t fileBytes = 0;                // Size of the written file
+};
+
+// Engine-wide concurrency, shared by every IGESNative of the process. Set it before the
+// engines start working
+struct ConcurrencyOptions {
+   int threads = 0;          // Threads of the OCCT pool the booleans run on, 0 for one per core
+   int jobThreads = 0;       // Threads one command may use for its own loops, 0 for all of them
+   bool sharedPool = false;  // Run the engine loops on the OCCT pool instead of OpenMP teams
+};
+
+// Memory figures of the engine, in bytes
+struct MemoryReport {
+   std::size_t slotBytes[3] = {};   // Estimated size of the Left, Right and Fused shapes
+   std::size_t sharedGeometryBytes[3] = {}; // Saved by sharing repeated geometry when each part was loaded
+   std::size_t workingSet = 0;      // Process working set now
+   std::size_t peakWorkingSet = 0;  // Process peak working set so far
+   std::string lastOperation;       // Last command measured
+   long long operationDelta = 0;    // Working set change over the last command
+   std::size_t operationPeak = 0;   // Peak working set at the end of the last command
+};
 
 class IGESNative {
    public:
@@ -113,9 +206,33 @@ class IGESNative {
    int LoadIGES(const std::string& filePath, int shapeType = 0);
    int SaveIGES(const std::string& filePath, int shapeType = 0);
    int SaveAsIGS(const std::string& filePath);
+   bool IsLoading(int shapeType) const; // A progressive load is still healing the part
+   int GenerateRails(const RailSpec& spec); // Synthetic Left and Right parts, see RailGenerator.h
+
+   // Round trip checks of the engine on a generated rail pair, written to the directory and read
+   // back. One line per check in rReport: PASS or FAIL, the check and what it measured. Returns
+   // CalculationError when a check failed
+   static int SelfTest(const std::string& directory, std::string& rReport);
+
+   // Hidden line top, side and end views of a part, see Projection.h
+   int ProjectViews(int shapeType, const ProjectionOptions& options, std::vector<ProjectedSegment>& rSegments);
+   int SaveDXF(const std::string& filePath, int shapeType, const ProjectionOptions& options);
+
+   // Sections of a part at stations along an axis, see Slicer.h for the buffer
+   int SliceSections(int shapeType, const std::vector<double>& stations, const SliceOptions& options,
+      std::vector<double>& rBuffer);
+
+   // Web, flange and hole features of a part, see FeatureRecognizer.h. The table stays with the
+   // engine until the next recognition, GetFeatures hands it out in place. Faces that fail
+   // give CalculationError, the table keeps the features of the others
+   int RecognizeFeatures(int shapeType, const FeatureOptions& options);
+   const FeatureRecord* GetFeatures(int& rCount) const;
 
    // Commands
    int UnionShapes();
+   int BudgetedJoin(double budgetSeconds, JoinBudgetReport& rReport); // Returns within the budget, see JoinBudgetReport
+   int CheckJoin(JoinCheck& rCheck);
+   int MirrorJoin(int shapeType = 0);
    int AlignToXYPlane(int shapeType = 0);
    int RotatePartBy180AboutZAxis(int shapeType);
    int YawBy180(int shapeType);
@@ -124,6 +241,27 @@ class IGESNative {
    void RotatePartByAxis(TopoDS_Shape& shape, double deg, EAxis axis);
    int UndoJoin();
 
+   // History of the commands that changed the parts
+   int Undo();
+   int Redo();
+   bool CanUndo() const;
+   bool CanRedo() const;
+
+   // Error of the last failed command on the calling thread
+   std::string GetErrorMessage() const;
+   MemoryReport GetMemoryReport();
+
+   void SetJoinOptions(const JoinOptions& options);
+   JoinOptions GetJoinOptions() const;
+   void SetLoadOptions(const LoadOptions& options);
+   LoadOptions GetLoadOptions() const;
+   void SetExportOptions(const ExportOptions& options);
+   ExportOptions GetExportOptions() const;
+   ExportReport GetExportReport() const;
+
+   static void SetConcurrency(const ConcurrencyOptions& options);
+   static ConcurrencyOptions GetConcurrency();
+
    void Zoom(bool zoomIn, int x, int y);
    void Pan(int dx, int dy);
    void Redraw();
@@ -133,7 +271,8 @@ class IGESNative {
 
    private:
    int getShape(TopoDS_Shape& shape, int shapeType);
-   int mirror(TopoDS_Shape leftShape);
+   int mirror(const TopoDS_Shape& shape, int shapeType);
+   int unionShapes();
 
    IGESShapePimpl* pShape = nullptr;
 };
\ No newline at end of file
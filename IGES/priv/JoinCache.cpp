@@ -0,0 +1,134 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "./../OcctHeaders.h"
+
+#include "JoinCache.h"
+
+namespace fs = std::filesystem;
+
+std::uint64_t JoinCache::Hash(const void* data, std::size_t size, std::uint64_t seed) {
+   const unsigned char* bytes = static_cast<const unsigned char*>(data);
+   std::uint64_t hash = seed;
+   for (std::size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull; // FNV-1a prime
+   }
+   return hash;
+}
+
+std::uint64_t JoinCache::Hash(const std::string& text, std::uint64_t seed) {
+   return Hash(text.data(), text.size(), seed);
+}
+
+bool JoinCache::HashFile(const std::string& filePath, std::uint64_t& rHash) {
+   std::ifstream file(filePath, std::ios::binary);
+   if (!file)
+      return false;
+
+   rHash = HashSeed;
+   std::vector<char> buffer(1 << 20);
+   while (file) {
+      file.read(buffer.data(), buffer.size());
+      rHash = Hash(buffer.data(), (std::size_t)file.gcount(), rHash);
+   }
+   return file.eof();
+}
+
+std::string JoinCache::ToHex(std::uint64_t hash) {
+   char text[17];
+   std::snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+   return text;
+}
+
+std::string JoinCache::DefaultDirectory() {
+   const char* localAppData = std::getenv("LOCALAPPDATA");
+   fs::path root = localAppData ? fs::path(localAppData) : fs::temp_directory_path();
+   return (root / "FChassis" / "JoinCache").string();
+}
+
+JoinCache& JoinCache::Shared() {
+   static JoinCache cache(DefaultDirectory(), DefaultMaxBytes);
+   return cache;
+}
+
+JoinCache::JoinCache(const std::string& directory, std::uintmax_t maxBytes)
+   : directory(directory), maxBytes(maxBytes) {}
+
+std::string JoinCache::entryPath(std::uint64_t key) const {
+   return (fs::path(this->directory) / (ToHex(key) + ".brep")).string();
+}
+
+bool JoinCache::Find(std::uint64_t key, TopoDS_Shape& rShape) {
+   std::lock_guard<std::mutex> lock(this->mutex);
+   std::string path = this->entryPath(key);
+   std::error_code ec;
+   if (!fs::exists(path, ec))
+      return false;
+
+   if (!BinTools::Read(rShape, path.c_str()) || rShape.IsNull())
+      return false;
+
+   // The write time orders the entries for the eviction
+   fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+   return true;
+}
+
+void JoinCache::Store(std::uint64_t key, const TopoDS_Shape& shape) {
+   if (shape.IsNull())
+      return;
+
+   std::lock_guard<std::mutex> lock(this->mutex);
+   std::error_code ec;
+   fs::create_directories(this->directory, ec);
+
+   // Write aside and rename, so that another process never reads a partial entry
+   std::string path = this->entryPath(key);
+   std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+   if (!BinTools::Write(shape, tempPath.c_str())) {
+      fs::remove(tempPath, ec);
+      return;
+   }
+   fs::rename(tempPath, path, ec);
+   if (ec) {
+      fs::remove(tempPath, ec);
+      return;
+   }
+   this->evict();
+}
+
+void JoinCache::evict() {
+   struct Entry {
+      fs::path path;
+      fs::file_time_type time;
+      std::uintmax_t size;
+   };
+   std::vector<Entry> entries;
+   std::uintmax_t total = 0;
+   std::error_code ec;
+   for (const auto& item : fs::directory_iterator(this->directory, ec)) {
+      if (item.path().extension() != ".brep")
+         continue;
+      Entry entry{ item.path(), item.last_write_time(ec), item.file_size(ec) };
+      if (ec)
+         continue;
+      total += entry.size;
+      entries.push_back(entry);
+   }
+   if (total <= this->maxBytes)
+      return;
+
+   std::sort(entries.begin(), entries.end(),
+      [](const Entry& a, const Entry& b) { return a.time < b.time; });
+   for (const auto& entry : entries) {
+      if (total <= this->maxBytes)
+         break;
+      if (fs::remove(entry.path, ec))
+         total -= entry.size;
+   }
+}
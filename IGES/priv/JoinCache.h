@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+class TopoDS_Shape;
+
+// Disk cache of join results. Each entry is the fused shape in BinTools form, named by the
+// hash of the join inputs: the content of both part files, the commands applied to each
+// part and the join options. Entries are evicted least recently used past a byte budget
+class JoinCache {
+   public:
+   static constexpr std::uint64_t HashSeed = 14695981039346656037ull; // FNV-1a offset basis
+   static constexpr std::uintmax_t DefaultMaxBytes = 1024ull * 1024 * 1024;
+
+   // FNV-1a, chained through the seed
+   static std::uint64_t Hash(const void* data, std::size_t size, std::uint64_t seed = HashSeed);
+   static std::uint64_t Hash(const std::string& text, std::uint64_t seed = HashSeed);
+   static bool HashFile(const std::string& filePath, std::uint64_t& rHash);
+   static std::string ToHex(std::uint64_t hash);
+
+   // %LOCALAPPDATA%\FChassis\JoinCache
+   static std::string DefaultDirectory();
+
+   // The cache shared by the engines of the process
+   static JoinCache& Shared();
+
+   JoinCache(const std::string& directory, std::uintmax_t maxBytes);
+
+   bool Find(std::uint64_t key, TopoDS_Shape& rShape);
+   void Store(std::uint64_t key, const TopoDS_Shape& shape);
+
+   private:
+   std::string entryPath(std::uint64_t key) const;
+   void evict();
+
+   std::string directory;
+   std::uintmax_t maxBytes = DefaultMaxBytes;
+   std::mutex mutex; // Engines of the join service share one cache
+};
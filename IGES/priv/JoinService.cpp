@@ -0,0 +1,351 @@
+﻿#define NOMINMAX // Disable the min/max macros
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <Standard_Failure.hxx>
+
+#include "IGESNative.h"
+#include "JoinService.h"
+
+namespace {
+   const DWORD PipeBufferSize = 64 * 1024;
+
+   // Read up to the first newline. Requests and replies are single lines
+   bool ReadLine(HANDLE pipe, std::string& rLine) {
+      rLine.clear();
+      char buffer[1024];
+      for (;;) {
+         DWORD read = 0;
+         if (!ReadFile(pipe, buffer, sizeof(buffer), &read, nullptr) || read == 0)
+            return !rLine.empty();
+         rLine.append(buffer, read);
+         size_t end = rLine.find('\n');
+         if (end != std::string::npos) {
+            rLine.resize(end);
+            if (!rLine.empty() && rLine.back() == '\r')
+               rLine.pop_back();
+            return true;
+         }
+      }
+   }
+
+   bool WriteLine(HANDLE pipe, const std::string& line) {
+      std::string data = line + "\n";
+      DWORD written = 0;
+      return WriteFile(pipe, data.data(), (DWORD)data.size(), &written, nullptr)
+         && written == data.size();
+   }
+
+   std::vector<std::string> Split(const std::string& text, char separator) {
+      std::vector<std::string> fields;
+      std::stringstream stream(text);
+      std::string field;
+      while (std::getline(stream, field, separator))
+         fields.push_back(field);
+      return fields;
+   }
+
+   // Run the arguments of one JOIN request on the engine and build the reply line. Errors
+   // of the engine come out as exceptions
+   std::string JoinUnguarded(IGESNative& engine, const std::string& arguments) {
+      auto start = std::chrono::steady_clock::now();
+      std::string path;
+      std::vector<std::string> fields = Split(arguments, '|');
+      if (fields.size() < 3 || fields.size() > 4)
+         return "ERROR Expected JOIN <left>|<right>|<output>|<ops>";
+
+      // Every request starts from the default options of the engine
+      JoinOptions options;
+      LoadOptions loadOptions;
+      ExportOptions exportOptions;
+      double budget = 0;
+      std::vector<std::string> ops;
+      if (fields.size() == 4)
+         ops = Split(fields[3], ',');
+      for (const auto& op : ops) {
+         if (op == "glue")
+            options.glueJoin = true;
+         else if (op == "speculative")
+            options.speculativeFuse = true;
+         else if (op == "refine")
+            options.localRefine = true;
+         else if (op == "cache")
+            options.useCache = true;
+         else if (op == "preflight")
+            options.preflight = true;
+         else if (op == "verify")
+            options.fastVerify = true;
+         else if (op == "heal")
+            options.targetedHealing = loadOptions.targetedHealing = true;
+         else if (op == "fastread")
+            loadOptions.fastReader = true;
+         else if (op == "share")
+            loadOptions.shareGeometry = true;
+         else if (op == "compact")
+            exportOptions.compact = true;
+         else if (op.rfind("budget=", 0) == 0)
+            budget = std::stod(op.substr(7));
+      }
+      engine.SetJoinOptions(options);
+      engine.SetLoadOptions(loadOptions);
+      engine.SetExportOptions(exportOptions);
+
+      if (engine.LoadIGES(fields[0], 0) || engine.LoadIGES(fields[1], 1))
+         return "ERROR " + engine.GetErrorMessage();
+
+      for (const auto& op : ops) {
+         if (op.size() < 2 || (op.back() != '1' && op.back() != '2') || op.find('=') != std::string::npos)
+            continue;
+         int part = op.back() - '1';
+         std::string name = op.substr(0, op.size() - 1);
+         int error = 0;
+         if (name == "align")
+            error = engine.AlignToXYPlane(part);
+         else if (name == "yaw")
+            error = engine.YawBy180(part);
+         else if (name == "roll")
+            error = engine.RollBy180(part);
+         else
+            return "ERROR Unknown operation " + op;
+         if (error)
+            return "ERROR " + engine.GetErrorMessage();
+      }
+
+      if (budget > 0) {
+         JoinBudgetReport report;
+         if (engine.BudgetedJoin(budget, report) || engine.SaveIGES(fields[2], 2))
+            return "ERROR " + engine.GetErrorMessage();
+         const char* paths[] = { "none", "full", "glue", "compound" };
+         path = paths[report.path];
+      }
+      else if (engine.UnionShapes() || engine.SaveIGES(fields[2], 2))
+         return "ERROR " + engine.GetErrorMessage();
+
+      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+         std::chrono::steady_clock::now() - start).count();
+      return "OK " + std::to_string(ms) + (path.empty() ? "" : " " + path);
+   }
+
+   // The service keeps serving whatever a join throws
+   std::string Join(IGESNative& engine, const std::string& arguments) {
+      try {
+         return JoinUnguarded(engine, arguments);
+      }
+      catch (const std::exception& ex) {
+         return std::string("ERROR ") + ex.what();
+      }
+      catch (...) {
+         return "ERROR An unknown error occurred while joining the parts";
+      }
+   }
+}
+
+class JoinServiceImpl {
+   public:
+   JoinServiceImpl(const std::string& pipeName, int workerCount)
+      : pipeName(pipeName), workerCount(workerCount > 0 ? workerCount : 1) {}
+
+   void Run() {
+      stopping = false;
+      started = std::chrono::steady_clock::now();
+
+      // Split the cores between the workers, unless the host chose a limit per job
+      ConcurrencyOptions concurrency = IGESNative::GetConcurrency();
+      if (concurrency.jobThreads == 0) {
+         int threads = concurrency.threads > 0 ? concurrency.threads : (int)std::thread::hardware_concurrency();
+         concurrency.jobThreads = std::max(1, threads / workerCount);
+         IGESNative::SetConcurrency(concurrency);
+      }
+      for (int i = 0; i < workerCount; i++)
+         workers.emplace_back([this] { this->Worker(); });
+
+      // Accept connections and hand them to the worker pool
+      while (!stopping) {
+         HANDLE pipe = CreateNamedPipeA(pipeName.c_str(), PIPE_ACCESS_DUPLEX,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, PIPE_UNLIMITED_INSTANCES,
+            PipeBufferSize, PipeBufferSize, 0, nullptr);
+         if (pipe == INVALID_HANDLE_VALUE)
+            break;
+
+         bool connected = ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED;
+         if (!connected || stopping) {
+            CloseHandle(pipe);
+            continue;
+         }
+
+         std::lock_guard<std::mutex> lock(mutex);
+         connections.push_back(pipe);
+         available.notify_one();
+      }
+
+      stopping = true;
+      available.notify_all();
+      for (auto& worker : workers)
+         worker.join();
+      workers.clear();
+
+      for (HANDLE pipe : connections)
+         CloseHandle(pipe);
+      connections.clear();
+   }
+
+   void Stop() {
+      if (stopping.exchange(true))
+         return;
+
+      // Wake the accept loop blocked in ConnectNamedPipe
+      HANDLE wake = CreateFileA(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+         OPEN_EXISTING, 0, nullptr);
+      if (wake != INVALID_HANDLE_VALUE)
+         CloseHandle(wake);
+      available.notify_all();
+   }
+
+   private:
+   // Each worker keeps its own engine for the life of the service
+   void Worker() {
+      IGESNative engine;
+      for (;;) {
+         HANDLE pipe = INVALID_HANDLE_VALUE;
+         {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stopping || !connections.empty(); });
+            if (connections.empty())
+               return;
+            pipe = connections.front();
+            connections.pop_front();
+         }
+
+         std::string request;
+         if (ReadLine(pipe, request)) {
+            WriteLine(pipe, Serve(engine, request));
+            FlushFileBuffers(pipe);
+         }
+         DisconnectNamedPipe(pipe);
+         CloseHandle(pipe);
+      }
+   }
+
+   std::string Serve(IGESNative& engine, const std::string& request) {
+      if (request == "PING")
+         return "PONG " + std::to_string(workerCount);
+
+      if (request == "STOP") {
+         Stop();
+         return "BYE";
+      }
+
+      if (request == "STATS")
+         return Stats();
+
+      if (request.rfind("JOIN ", 0) == 0) {
+         auto start = std::chrono::steady_clock::now();
+         std::string reply = Join(engine, request.substr(5));
+         busyMs += std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+         (reply.rfind("OK", 0) == 0 ? joined : failed)++;
+         MemoryReport memory = engine.GetMemoryReport();
+         sharedBytes += (long long)(memory.sharedGeometryBytes[0] + memory.sharedGeometryBytes[1]);
+         return reply;
+      }
+
+      return "ERROR Unknown request";
+   }
+
+   // Throughput since the start: joins done and failed, mean join time, joins per minute and
+   // the bytes sharing the repeated geometry saved on the loaded parts
+   std::string Stats() {
+      double minutes = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() / 60;
+      long long done = joined, total = joined + failed;
+      std::ostringstream reply;
+      reply << "STATS " << done << " " << failed.load() << " "
+         << (total ? busyMs.load() / total : 0) << " " << (minutes > 0 ? done / minutes : 0)
+         << " " << sharedBytes.load();
+      return reply.str();
+   }
+
+   std::string pipeName;
+   int workerCount = 1;
+   std::atomic<bool> stopping{ false };
+   std::mutex mutex;
+   std::condition_variable available;
+   std::deque<HANDLE> connections;
+   std::vector<std::thread> workers;
+
+   std::chrono::steady_clock::time_point started;
+   std::atomic<long long> joined{ 0 }, failed{ 0 }, busyMs{ 0 }, sharedBytes{ 0 };
+};
+
+JoinService::JoinService(const std::string& pipeName, int workerCount) {
+   pImpl = new JoinServiceImpl(pipeName, workerCount);
+}
+
+JoinService::~JoinService() {
+   delete pImpl;
+   pImpl = nullptr;
+}
+
+void JoinService::Run() {
+   pImpl->Run();
+}
+
+void JoinService::Stop() {
+   pImpl->Stop();
+}
+
+std::string ExecuteJoinRequest(const std::string& request) {
+   if (request.rfind("JOIN ", 0) != 0)
+      return "ERROR Expected JOIN <left>|<right>|<output>|<ops>";
+   // Only C++ and OCCT errors become an ERROR reply. A fault in the worker is left to take
+   // the process down, so that the supervisor sees the crash and retries the job
+   IGESNative engine;
+   try {
+      return JoinUnguarded(engine, request.substr(5));
+   }
+   catch (const std::exception& ex) {
+      return std::string("ERROR ") + ex.what();
+   }
+   catch (const Standard_Failure& ex) {
+      return std::string("ERROR ") + ex.GetMessageString();
+   }
+}
+
+bool SendJoinRequest(const std::string& pipeName, const std::string& request,
+   std::string& rReply, int connectTimeoutMs) {
+   rReply.clear();
+   // The wait returns at once while the service has not created the pipe yet, and a
+   // free instance can be taken by another client before it is opened
+   auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(0, connectTimeoutMs));
+   HANDLE pipe = INVALID_HANDLE_VALUE;
+   for (;;) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+      if (left <= 0)
+         return false;
+      if (!WaitNamedPipeA(pipeName.c_str(), (DWORD)left)) {
+         if (GetLastError() != ERROR_FILE_NOT_FOUND)
+            return false;
+         std::this_thread::sleep_for(std::chrono::milliseconds(std::min<long long>(left, 50)));
+         continue;
+      }
+      pipe = CreateFileA(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+         OPEN_EXISTING, 0, nullptr);
+      if (pipe != INVALID_HANDLE_VALUE)
+         break;
+      DWORD error = GetLastError();
+      if (error != ERROR_PIPE_BUSY && error != ERROR_FILE_NOT_FOUND)
+         return false;
+   }
+
+   bool ok = WriteLine(pipe, request) && ReadLine(pipe, rReply);
+   CloseHandle(pipe);
+   return ok;
+}
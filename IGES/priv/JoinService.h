@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <string>
+
+class JoinServiceImpl;
+
+// Long lived join service. A pool of workers, each owning a warm headless IGESNative,
+// serves join requests over a local named pipe. The OCCT toolkits are loaded once for
+// the life of the process, so clients pay no start-up cost. Unless the engine concurrency
+// sets a limit per job, each join gets an equal share of the cores. The IGES read and write
+// of a job are serialized across the workers (Concurrency::ExchangeMutex), the healing and the
+// booleans run in parallel.
+//
+// One request line per connection, answered by one reply line:
+//    JOIN <left>|<right>|<output>|<ops>   ->  OK <milliseconds> [<path>]  or  ERROR <message>
+//    PING                                 ->  PONG <workers>
+//    STATS                                ->  STATS <joined> <failed> <mean ms> <joins per minute> <shared bytes>
+//    STOP                                 ->  BYE
+// <ops> is an optional comma separated list, applied in order before the join:
+//    align1, align2, yaw1, yaw2, roll1, roll2 (part 1 or 2), glue, speculative, refine, cache,
+//    preflight, verify (fast verification), heal (targeted healing), fastread (parallel IGES parser),
+//    share (share the geometry of repeated holes, the saving adds up in STATS),
+//    compact (compact the written model), budget=<seconds> (join within the time, the reply
+//    names the path taken: full, glue or compound)
+class JoinService {
+   public:
+   static constexpr const char* DefaultPipeName = "\\\\.\\pipe\\FChassis.IGES.Join";
+
+   JoinService(const std::string& pipeName, int workerCount);
+   ~JoinService();
+
+   // Serve until a STOP request arrives or Stop is called
+   void Run();
+   void Stop();
+
+   private:
+   JoinServiceImpl* pImpl = nullptr;
+};
+
+// Run one JOIN request line on a fresh engine in this process and return the reply line.
+// Worker processes of the JoinSupervisor use it
+std::string ExecuteJoinRequest(const std::string& request);
+
+// Send one request line to the service and wait for the reply line. Returns false
+// when no service answers on the pipe within the connect timeout
+bool SendJoinRequest(const std::string& pipeName, const std::string& request,
+   std::string& rReply, int connectTimeoutMs = 2000);
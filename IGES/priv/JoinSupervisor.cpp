@@ -0,0 +1,181 @@
+﻿#define NOMINMAX // Disable the min/max macros
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "JoinSupervisor.h"
+
+namespace {
+   // Held while a worker is started, see RunWorker
+   std::mutex startMutex;
+
+   // The reply is the last OK or ERROR line; the engine logs to the same output
+   std::string ReplyLine(const std::string& output) {
+      std::istringstream stream(output);
+      std::string line, reply;
+      while (std::getline(stream, line)) {
+         if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+         if (line.rfind("OK", 0) == 0 || line.rfind("ERROR", 0) == 0)
+            reply = line;
+      }
+      return reply;
+   }
+
+   // One attempt of a job in a new worker process
+   SupervisedJob::Outcome RunWorker(const std::string& workerPath, const std::string& request,
+      const SupervisorOptions& options, std::string& rReply) {
+      HANDLE job = CreateJobObjectA(nullptr, nullptr);
+      if (!job) {
+         rReply = "ERROR Could not create the job object of the worker";
+         return SupervisedJob::Failed;
+      }
+      JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+      limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE
+         | JOB_OBJECT_LIMIT_DIE_ON_UNHANDLED_EXCEPTION;
+      if (options.memoryLimitMB > 0) {
+         limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_PROCESS_MEMORY;
+         limits.ProcessMemoryLimit = options.memoryLimitMB << 20;
+      }
+      SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+
+      HANDLE readPipe = nullptr, writePipe = nullptr;
+      if (!CreatePipe(&readPipe, &writePipe, nullptr, 0)) {
+         CloseHandle(job);
+         rReply = "ERROR Could not create the output pipe of the worker";
+         return SupervisedJob::Failed;
+      }
+      STARTUPINFOA startup = { sizeof(startup) };
+      startup.dwFlags = STARTF_USESTDHANDLES;
+      startup.hStdInput = nullptr;
+      startup.hStdOutput = writePipe;
+      startup.hStdError = writePipe;
+      PROCESS_INFORMATION process = {};
+      std::string commandLine = "\"" + workerPath + "\" worker \"" + request + "\"";
+
+      // The write end is inheritable only while this worker starts, or the workers started
+      // meanwhile would hold it open. Suspended until it is in the job, so that no
+      // allocation escapes the limit
+      bool started = false;
+      {
+         std::lock_guard<std::mutex> lock(startMutex);
+         SetHandleInformation(writePipe, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+         started = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE,
+            CREATE_SUSPENDED | CREATE_NO_WINDOW, nullptr, nullptr, &startup, &process);
+         CloseHandle(writePipe);
+      }
+      if (!started) {
+         CloseHandle(readPipe);
+         CloseHandle(job);
+         rReply = "ERROR Could not start the worker " + workerPath;
+         return SupervisedJob::Failed;
+      }
+      // Outside the job the worker would run without the limit and outlive the supervisor
+      if (!AssignProcessToJobObject(job, process.hProcess)) {
+         DWORD error = GetLastError();
+         TerminateProcess(process.hProcess, 1);
+         WaitForSingleObject(process.hProcess, INFINITE);
+         CloseHandle(process.hThread);
+         CloseHandle(process.hProcess);
+         CloseHandle(readPipe);
+         CloseHandle(job);
+         rReply = "ERROR Could not put the worker in its job object, error " + std::to_string(error);
+         return SupervisedJob::Failed;
+      }
+      ResumeThread(process.hThread);
+
+      // Drain the output as it comes, a full pipe would stall the worker
+      std::string output;
+      std::thread reader([&] {
+         char buffer[4096];
+         DWORD read = 0;
+         while (ReadFile(readPipe, buffer, sizeof(buffer), &read, nullptr) && read > 0)
+            output.append(buffer, read);
+      });
+
+      DWORD timeout = options.timeoutSeconds > 0 ? (DWORD)options.timeoutSeconds * 1000 : INFINITE;
+      bool timedOut = WaitForSingleObject(process.hProcess, timeout) == WAIT_TIMEOUT;
+      if (timedOut) {
+         TerminateJobObject(job, 1);
+         WaitForSingleObject(process.hProcess, INFINITE);
+      }
+      reader.join();
+
+      DWORD exitCode = 0;
+      GetExitCodeProcess(process.hProcess, &exitCode);
+      JOBOBJECT_EXTENDED_LIMIT_INFORMATION usage = {};
+      QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &usage, sizeof(usage), nullptr);
+      CloseHandle(process.hThread);
+      CloseHandle(process.hProcess);
+      CloseHandle(readPipe);
+      CloseHandle(job);
+
+      rReply = ReplyLine(output);
+      if (timedOut) {
+         rReply = "ERROR The worker timed out after " + std::to_string(options.timeoutSeconds) + " s";
+         return SupervisedJob::TimedOut;
+      }
+      if (exitCode == 0 && rReply.rfind("OK", 0) == 0)
+         return SupervisedJob::Done;
+
+      // Allocations fail close to the limit, whatever the worker made of it
+      if (options.memoryLimitMB > 0 && usage.PeakProcessMemoryUsed + (16u << 20) >= limits.ProcessMemoryLimit) {
+         rReply = "ERROR The worker reached its " + std::to_string(options.memoryLimitMB) + " MB memory limit";
+         return SupervisedJob::OutOfMemory;
+      }
+      if (rReply.rfind("ERROR", 0) == 0)
+         return SupervisedJob::Failed;
+
+      std::ostringstream crash;
+      crash << "ERROR The worker died with exit code 0x" << std::hex << exitCode;
+      rReply = crash.str();
+      return SupervisedJob::Crashed;
+   }
+}
+
+std::vector<SupervisedJob> RunSupervised(const std::string& workerPath,
+   const std::vector<std::string>& requests, const SupervisorOptions& options) {
+   std::vector<SupervisedJob> jobs(requests.size());
+   for (std::size_t i = 0; i < requests.size(); i++)
+      jobs[i].request = requests[i];
+
+   int workers = options.workers > 0 ? options.workers : std::max(1, (int)std::thread::hardware_concurrency() / 4);
+   workers = std::min<int>(workers, (int)std::max<std::size_t>(1, jobs.size()));
+
+   // Each supervisor thread takes the next job and sees it through, worker by worker
+   std::atomic<std::size_t> next{ 0 };
+   std::vector<std::thread> threads;
+   for (int w = 0; w < workers; w++)
+      threads.emplace_back([&] {
+         for (std::size_t i = next++; i < jobs.size(); i = next++) {
+            SupervisedJob& job = jobs[i];
+            auto start = std::chrono::steady_clock::now();
+            do {
+               job.attempts++;
+               job.outcome = RunWorker(workerPath, job.request, options, job.reply);
+            } while (job.outcome == SupervisedJob::Crashed && job.attempts <= options.retries);
+            job.ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start).count();
+         }
+      });
+   for (auto& thread : threads)
+      thread.join();
+   return jobs;
+}
+
+const char* OutcomeName(SupervisedJob::Outcome outcome) {
+   switch (outcome) {
+      case SupervisedJob::Done: return "Done";
+      case SupervisedJob::Failed: return "Failed";
+      case SupervisedJob::TimedOut: return "TimedOut";
+      case SupervisedJob::OutOfMemory: return "OutOfMemory";
+      case SupervisedJob::Crashed: return "Crashed";
+   }
+   return "Unknown";
+}
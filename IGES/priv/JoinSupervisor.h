@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One job run by RunSupervised and how it ended
+struct SupervisedJob {
+   enum Outcome { Done, Failed, TimedOut, OutOfMemory, Crashed };
+
+   std::string request;      // JOIN <left>|<right>|<output>|<ops>
+   Outcome outcome = Failed;
+   std::string reply;        // Reply line of the worker, or what the supervisor saw of it
+   int attempts = 0;
+   long long ms = 0;         // Wall clock of all the attempts
+};
+
+struct SupervisorOptions {
+   int workers = 0;                 // Jobs run at once, 0 for a quarter of the cores
+   int timeoutSeconds = 900;        // Wall clock limit of one attempt, 0 for none
+   std::size_t memoryLimitMB = 0;   // Committed memory limit of one worker, 0 for none
+   int retries = 1;                 // Attempts added after a crash
+};
+
+// Batch joins in crash-isolated worker processes. Every attempt runs in a new worker,
+// a child process inside a job object that enforces the memory limit and goes down with
+// the supervisor. A worker that hangs past the timeout is killed; one that crashes is
+// replaced and its job retried. The other jobs keep running either way.
+//
+// The worker is started as: <workerPath> worker "<request>". It runs the request with
+// ExecuteJoinRequest, prints the reply line and exits with 0 on OK. The parts and the
+// result go through the files the request names
+std::vector<SupervisedJob> RunSupervised(const std::string& workerPath,
+   const std::vector<std::string>& requests, const SupervisorOptions& options);
+
+const char* OutcomeName(SupervisedJob::Outcome outcome);
@@ -0,0 +1,201 @@
+﻿#define NOMINMAX // Disable the min/max macros
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "./../OcctHeaders.h"
+
+#include "Concurrency.h"
+#include "Projection.h"
+
+namespace {
+   const int ViewCount = 3;
+   const char* ViewNames[ViewCount] = { "TOP", "SIDE", "END" };
+
+   // Eye of each view: the projection looks down the Z of the axes, X of the axes to the right
+   HLRAlgo_Projector ViewProjector(ProjectionView view) {
+      switch (view) {
+         case ProjectionView::Top: return HLRAlgo_Projector(gp_Ax2(gp::Origin(), gp_Dir(0, 0, 1), gp_Dir(1, 0, 0)));
+         case ProjectionView::Side: return HLRAlgo_Projector(gp_Ax2(gp::Origin(), gp_Dir(0, -1, 0), gp_Dir(1, 0, 0)));
+         default: return HLRAlgo_Projector(gp_Ax2(gp::Origin(), gp_Dir(1, 0, 0), gp_Dir(0, 1, 0)));
+      }
+   }
+
+   // Split the edges of a result compound into segments. The edges lie in the plane of the
+   // view, straight ones give one segment
+   void AddEdges(const TopoDS_Shape& edges, ProjectionView view, bool hidden, double deflection,
+      std::vector<ProjectedSegment>& rSegments) {
+      if (edges.IsNull())
+         return;
+      BRepLib::BuildCurves3d(edges);
+      for (TopExp_Explorer edgeExp(edges, TopAbs_EDGE); edgeExp.More(); edgeExp.Next()) {
+         BRepAdaptor_Curve curve(TopoDS::Edge(edgeExp.Current()));
+         std::vector<gp_Pnt> points;
+         if (curve.GetType() == GeomAbs_Line) {
+            points = { curve.Value(curve.FirstParameter()), curve.Value(curve.LastParameter()) };
+         }
+         else {
+            GCPnts_QuasiUniformDeflection sampler(curve, deflection);
+            if (!sampler.IsDone())
+               continue;
+            for (int i = 1; i <= sampler.NbPoints(); ++i)
+               points.push_back(sampler.Value(i));
+         }
+         for (std::size_t i = 1; i < points.size(); i++)
+            rSegments.push_back({ view, hidden, points[i - 1].X(), points[i - 1].Y(), points[i].X(), points[i].Y() });
+      }
+   }
+
+   void ProjectView(const TopoDS_Shape& shape, ProjectionView view, const ProjectionOptions& options,
+      std::vector<ProjectedSegment>& rSegments) {
+      HLRAlgo_Projector projector = ViewProjector(view);
+      auto add = [&](const TopoDS_Shape& edges, bool hidden) {
+         AddEdges(edges, view, hidden, options.deflection, rSegments);
+      };
+      if (options.exact) {
+         Handle(HLRBRep_Algo) algo = new HLRBRep_Algo();
+         algo->Add(shape);
+         algo->Projector(projector);
+         algo->Update();
+         algo->Hide();
+         HLRBRep_HLRToShape toShape(algo);
+         add(toShape.VCompound(), false);
+         add(toShape.Rg1LineVCompound(), false);
+         add(toShape.OutLineVCompound(), false);
+         if (options.hidden) {
+            add(toShape.HCompound(), true);
+            add(toShape.OutLineHCompound(), true);
+         }
+         return;
+      }
+
+      Handle(HLRBRep_PolyAlgo) algo = new HLRBRep_PolyAlgo();
+      algo->Load(shape);
+      algo->Projector(projector);
+      algo->Update();
+      HLRBRep_PolyHLRToShape toShape;
+      toShape.Update(algo);
+      add(toShape.VCompound(), false);
+      add(toShape.Rg1LineVCompound(), false);
+      add(toShape.OutLineVCompound(), false);
+      if (options.hidden) {
+         add(toShape.HCompound(), true);
+         add(toShape.OutLineHCompound(), true);
+      }
+   }
+
+   struct Extent {
+      double xmin = std::numeric_limits<double>::max(), ymin = xmin;
+      double xmax = -xmin, ymax = -xmin;
+
+      void Add(const std::vector<ProjectedSegment>& segments) {
+         for (const ProjectedSegment& s : segments) {
+            xmin = std::min({ xmin, s.x0, s.x1 });
+            xmax = std::max({ xmax, s.x0, s.x1 });
+            ymin = std::min({ ymin, s.y0, s.y1 });
+            ymax = std::max({ ymax, s.y0, s.y1 });
+         }
+      }
+
+      bool IsEmpty() const {
+         return xmin > xmax;
+      }
+   };
+}
+
+bool ProjectShape(const TopoDS_Shape& shape, const ProjectionOptions& options,
+   std::vector<ProjectedSegment>& rSegments, std::string& rError) {
+   rSegments.clear();
+   rError.clear();
+   if (shape.IsNull())
+      return false;
+
+   // The polygonal algorithm works on the triangulation, built once for the three views
+   if (!options.exact)
+      BRepMesh_IncrementalMesh mesh(shape, options.deflection, Standard_False, 0.5, Standard_True);
+
+   std::vector<ProjectedSegment> views[ViewCount];
+   std::string errors[ViewCount];
+   std::atomic<bool> failed{ false };
+   Concurrency::For(ViewCount, [&](int v) {
+      try {
+         ProjectView(shape, (ProjectionView)v, options, views[v]);
+      }
+      catch (const Standard_Failure& ex) {
+         errors[v] = std::string(ViewNames[v]) + " view: " + ex.GetMessageString();
+         failed = true;
+      }
+      catch (const std::exception& ex) {
+         // Nothing may escape a thread of the loop, bad_alloc included
+         errors[v] = std::string(ViewNames[v]) + " view: " + ex.what();
+         failed = true;
+      }
+   });
+   if (failed) {
+      for (const std::string& error : errors)
+         if (!error.empty())
+            rError += (rError.empty() ? "" : "; ") + error;
+      return false;
+   }
+
+   // The side view at the origin, the top view above it and the end view right of it
+   Extent top, side, end;
+   top.Add(views[(int)ProjectionView::Top]);
+   side.Add(views[(int)ProjectionView::Side]);
+   end.Add(views[(int)ProjectionView::End]);
+   if (side.IsEmpty())
+      return false;
+   double dx[ViewCount], dy[ViewCount];
+   dx[(int)ProjectionView::Side] = dx[(int)ProjectionView::Top] = -side.xmin;
+   dy[(int)ProjectionView::Side] = dy[(int)ProjectionView::End] = -side.ymin;
+   dy[(int)ProjectionView::Top] = top.IsEmpty() ? 0 : side.ymax - side.ymin + options.spacing - top.ymin;
+   dx[(int)ProjectionView::End] = end.IsEmpty() ? 0 : side.xmax - side.xmin + options.spacing - end.xmin;
+
+   for (int v = 0; v < ViewCount; v++) {
+      for (ProjectedSegment s : views[v]) {
+         s.x0 += dx[v];
+         s.x1 += dx[v];
+         s.y0 += dy[v];
+         s.y1 += dy[v];
+         rSegments.push_back(s);
+      }
+   }
+   return true;
+}
+
+bool WriteProjectionDXF(const std::vector<ProjectedSegment>& segments, const std::string& filePath) {
+   std::ofstream dxf(filePath, std::ios::binary);
+   if (!dxf)
+      return false;
+
+   Extent extent;
+   extent.Add(segments);
+   if (extent.IsEmpty())
+      extent.xmin = extent.ymin = extent.xmax = extent.ymax = 0;
+
+   char line[160];
+   auto point = [&](int code, double x, double y) {
+      std::snprintf(line, sizeof(line), "%d\n%.4f\n%d\n%.4f\n%d\n0.0\n", code, x, code + 10, y, code + 20);
+      dxf << line;
+   };
+   dxf << "0\nSECTION\n2\nHEADER\n9\n$ACADVER\n1\nAC1009\n9\n$INSUNITS\n70\n4\n";
+   dxf << "9\n$EXTMIN\n";
+   point(10, extent.xmin, extent.ymin);
+   dxf << "9\n$EXTMAX\n";
+   point(10, extent.xmax, extent.ymax);
+   dxf << "0\nENDSEC\n0\nSECTION\n2\nENTITIES\n";
+   for (const ProjectedSegment& s : segments) {
+      // Hidden lines in grey on a layer of their own
+      dxf << "0\nLINE\n8\n" << ViewNames[(int)s.view] << (s.hidden ? "_HIDDEN\n62\n8\n" : "\n");
+      point(10, s.x0, s.y0);
+      point(11, s.x1, s.y1);
+   }
+   dxf << "0\nENDSEC\n0\nEOF\n";
+   return (bool)dxf.flush();
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+
+class TopoDS_Shape;
+
+// Views of a rail for shop drawings and nesting, all in mm. Top looks down Z with X to the
+// right, side looks along +Y with X to the right and end looks along -X with Y to the right
+enum class ProjectionView { Top = 0, Side = 1, End = 2 };
+
+struct ProjectionOptions {
+   bool exact = false;       // Hidden lines of the B-rep with HLRBRep_Algo, else of its mesh with HLRBRep_PolyAlgo
+   bool hidden = false;      // Keep the hidden lines too
+   double deflection = 0.1;  // Of the mesh and of the curves split into segments
+   double spacing = 100;     // Between the views on the sheet
+};
+
+// One segment of a view, laid out on the sheet: the top view above the side view and the end
+// view right of it, in projection so that X and Z line up across the views
+struct ProjectedSegment {
+   ProjectionView view;
+   bool hidden;
+   double x0, y0, x1, y1;
+};
+
+// Hidden line removal of the three views, one per thread. Returns false when a view failed,
+// with the views that threw and why in rError
+bool ProjectShape(const TopoDS_Shape& shape, const ProjectionOptions& options,
+   std::vector<ProjectedSegment>& rSegments, std::string& rError);
+
+// Stream the segments to an R12 DXF as LINE entities, on one layer per view and per visibility
+bool WriteProjectionDXF(const std::vector<ProjectedSegment>& segments, const std::string& filePath);
@@ -0,0 +1,140 @@
+﻿#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+// OCCT only, no viewer or Windows headers, so that the generator builds on any platform
+#include <BRepAlgoAPI_Cut.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_NurbsConvert.hxx>
+#include <BRepFilletAPI_MakeFillet2d.hxx>
+#include <BRepPrimAPI_MakeCylinder.hxx>
+#include <BRepPrimAPI_MakePrism.hxx>
+#include <BRep_Tool.hxx>
+#include <IGESControl_Writer.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Face.hxx>
+#include <TopoDS_Shape.hxx>
+#include <TopoDS_Vertex.hxx>
+#include <gp_Ax2.hxx>
+#include <gp_Pnt.hxx>
+#include <gp_Vec.hxx>
+
+#include "Concurrency.h"
+#include "RailGenerator.h"
+
+namespace {
+   struct Corner {
+      double y, z;
+      double radius; // Fillet of the corner, 0 when it stays sharp
+   };
+
+   // Section in the YZ plane, counter clockwise. Each bend has its inside corner on the
+   // bend radius and its outside corner on the radius plus the thickness, about one centre.
+   // The web of the C channel is normal to Z like the crown of the hat section, the
+   // flanges are normal to Y
+   std::vector<Corner> Profile(const RailSpec& spec) {
+      double t = spec.thickness, h = spec.height, r = spec.cornerRadius, R = r > 0 ? r + t : 0;
+      if (spec.section == RailSpec::CChannel) {
+         double w = spec.flangeHeight;
+         return { { 0, 0, R }, { h, 0, R }, { h, w, 0 }, { h - t, w, 0 },
+            { h - t, t, r }, { t, t, r }, { t, w, 0 }, { 0, w, 0 } };
+      }
+      double c = spec.crownWidth / 2, b = spec.flangeHeight;
+      return { { -c - b, 0, 0 }, { -c + t, 0, R }, { -c + t, h - t, r }, { c - t, h - t, r },
+         { c - t, 0, R }, { c + b, 0, 0 }, { c + b, t, 0 }, { c, t, r },
+         { c, h, R }, { -c, h, R }, { -c, t, r }, { -c - b, t, 0 } };
+   }
+
+   TopoDS_Face MakeProfile(const RailSpec& spec, double x) {
+      std::vector<Corner> corners = Profile(spec);
+      BRepBuilderAPI_MakePolygon polygon;
+      for (const Corner& corner : corners)
+         polygon.Add(gp_Pnt(x, corner.y, corner.z));
+      polygon.Close();
+      TopoDS_Face profile = BRepBuilderAPI_MakeFace(polygon.Wire(), Standard_True).Face();
+      if (spec.cornerRadius <= 0)
+         return profile;
+
+      TopTools_IndexedMapOfShape vertices;
+      TopExp::MapShapes(profile, TopAbs_VERTEX, vertices);
+      BRepFilletAPI_MakeFillet2d fillet(profile);
+      for (int i = 1; i <= vertices.Extent(); ++i) {
+         const TopoDS_Vertex& vertex = TopoDS::Vertex(vertices(i));
+         gp_Pnt point = BRep_Tool::Pnt(vertex);
+         for (const Corner& corner : corners)
+            if (corner.radius > 0 && std::abs(point.Y() - corner.y) < 1e-7 && std::abs(point.Z() - corner.z) < 1e-7)
+               fillet.AddFillet(vertex, corner.radius);
+      }
+      fillet.Build();
+      if (!fillet.IsDone())
+         throw std::invalid_argument("The bends do not fit the section, reduce the corner radius");
+      return TopoDS::Face(fillet.Shape());
+   }
+}
+
+TopoDS_Shape MakeRail(const RailSpec& spec, double xStart) {
+   double t = spec.thickness, h = spec.height, bend = spec.cornerRadius > 0 ? spec.cornerRadius + t : 0;
+   if (t <= 0 || spec.length <= 0 || h <= 2 * bend + t)
+      throw std::invalid_argument("The rail is too thin or too short for its bends");
+
+   TopoDS_Shape rail = BRepPrimAPI_MakePrism(MakeProfile(spec, xStart), gp_Vec(spec.length, 0, 0)).Shape();
+
+   // Rows of holes through the flat of the web or the crown, centred in equal pitches
+   int perRow = (int)std::floor(spec.holesPerMetre * spec.length / 1000);
+   if (perRow <= 0 || spec.holeRows <= 0)
+      return rail;
+   double pitch = spec.length / perRow, radius = spec.holeDiameter / 2;
+   double flat = spec.section == RailSpec::CChannel ? h - 2 * bend : spec.crownWidth - 2 * bend;
+   if (pitch <= spec.holeDiameter || flat / (spec.holeRows + 1) <= spec.holeDiameter)
+      throw std::invalid_argument("The holes do not fit the rail, lower the hole density");
+
+   TopTools_ListOfShape holes;
+   int index = 0;
+   for (int row = 0; row < spec.holeRows; ++row) {
+      double across = bend + flat * (row + 1) / (spec.holeRows + 1);
+      for (int k = 0; k < perRow; ++k, ++index) {
+         double x = xStart + (k + 0.5) * pitch;
+         gp_Ax2 axis = spec.section == RailSpec::CChannel
+            ? gp_Ax2(gp_Pnt(x, across, -1), gp_Dir(0, 0, 1))
+            : gp_Ax2(gp_Pnt(x, -spec.crownWidth / 2 + across, h - t - 1), gp_Dir(0, 0, 1));
+         TopoDS_Shape hole = BRepPrimAPI_MakeCylinder(axis, radius, t + 2).Shape();
+
+         // Spread the B-spline holes evenly over the pattern
+         if (std::floor((index + 1) * spec.splineFraction) > std::floor(index * spec.splineFraction))
+            hole = BRepBuilderAPI_NurbsConvert(hole).Shape();
+         holes.Append(hole);
+      }
+   }
+
+   TopTools_ListOfShape arguments;
+   arguments.Append(rail);
+   BRepAlgoAPI_Cut cut;
+   cut.SetArguments(arguments);
+   cut.SetTools(holes);
+   cut.SetRunParallel(Standard_True);
+   cut.Build();
+   if (!cut.IsDone())
+      throw std::runtime_error("Cutting the holes of the rail failed");
+   return cut.Shape();
+}
+
+void MakeRailPair(const RailSpec& spec, TopoDS_Shape& rLeft, TopoDS_Shape& rRight) {
+   rLeft = MakeRail(spec, 0);
+   rRight = MakeRail(spec, spec.length + spec.gap);
+}
+
+bool WriteRailPair(const RailSpec& spec, const std::string& leftPath, const std::string& rightPath) {
+   TopoDS_Shape left, right;
+   MakeRailPair(spec, left, right);
+   auto write = [](const TopoDS_Shape& shape, const std::string& path) {
+      std::lock_guard<std::mutex> lock(Concurrency::ExchangeMutex());
+      IGESControl_Writer writer;
+      writer.AddShape(shape);
+      return writer.Write(path.c_str());
+   };
+   return write(left, leftPath) && write(right, rightPath);
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <string>
+
+class TopoDS_Shape;
+
+// Parameters of a synthetic chassis rail. Lengths in mm, the rail runs along +X
+struct RailSpec {
+   enum Section { CChannel = 0, HatSection = 1 };
+
+   Section section = CChannel;
+   double length = 2000;        // Of each rail of the pair
+   double height = 200;         // Web of the C channel, walls of the hat section
+   double flangeHeight = 60;    // Flanges of the C channel, brims of the hat section
+   double crownWidth = 120;     // Top of the hat section
+   double thickness = 6;
+   double cornerRadius = 6;     // Inside radius of the bends, 0 for sharp corners
+   double holesPerMetre = 10;   // Holes of each row
+   int holeRows = 2;            // Rows across the web of the C channel or the crown of the hat
+   double holeDiameter = 12;
+   double splineFraction = 0;   // Share of the holes built on B-spline surfaces, 0 to 1
+   double gap = 0;              // Along X between the left and the right rail
+};
+
+// Synthetic rails for the scaling tests of the engine. Part size, face count and hole
+// count follow the spec, so join cost can be measured without customer parts. The
+// generator is built with the Windows engine only, there is no Linux build of it or of
+// the join. The IGES files it writes carry the parts to other machines, the joins and
+// benches still run on Windows through IGES.Host
+TopoDS_Shape MakeRail(const RailSpec& spec, double xStart = 0);
+
+// The left rail starts at X = 0, the right one gap after the end of the left one
+void MakeRailPair(const RailSpec& spec, TopoDS_Shape& rLeft, TopoDS_Shape& rRight);
+bool WriteRailPair(const RailSpec& spec, const std::string& leftPath, const std::string& rightPath);
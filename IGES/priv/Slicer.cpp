@@ -0,0 +1,168 @@
+﻿#define NOMINMAX // Disable the min/max macros
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "./../OcctHeaders.h"
+
+#include "Concurrency.h"
+#include "Slicer.h"
+
+namespace {
+   const gp_Dir Axes[3] = { gp_Dir(1, 0, 0), gp_Dir(0, 1, 0), gp_Dir(0, 0, 1) };
+
+   // Extent of each face along the axis, in the order of TopExp::MapShapes
+   std::vector<std::pair<double, double>> FaceRanges(const TopTools_IndexedMapOfShape& faces, int axis,
+      double tolerance) {
+      std::vector<std::pair<double, double>> ranges(faces.Extent());
+      Concurrency::For(faces.Extent(), [&](int i) {
+         Bnd_Box box;
+         BRepBndLib::Add(faces(i + 1), box, Standard_False);
+         if (box.IsVoid())
+            return;
+         double min[3], max[3];
+         box.Get(min[0], min[1], min[2], max[0], max[1], max[2]);
+         ranges[i] = { min[axis] - tolerance, max[axis] + tolerance };
+      });
+      return ranges;
+   }
+
+   // Points of the wire in its order, in the coordinates of the cutting plane
+   void AddPolyline(const TopoDS_Wire& wire, int axis, double deflection, std::vector<double>& rBuffer) {
+      int u = (axis + 1) % 3, v = (axis + 2) % 3;
+      std::size_t countAt = rBuffer.size();
+      rBuffer.push_back(0);
+      int count = 0;
+      for (BRepTools_WireExplorer edgeExp(wire); edgeExp.More(); edgeExp.Next()) {
+         BRepAdaptor_Curve curve(edgeExp.Current());
+         std::vector<gp_Pnt> points;
+         if (curve.GetType() == GeomAbs_Line) {
+            points = { curve.Value(curve.FirstParameter()), curve.Value(curve.LastParameter()) };
+         }
+         else {
+            GCPnts_QuasiUniformDeflection sampler(curve, deflection);
+            if (!sampler.IsDone())
+               continue;
+            for (int i = 1; i <= sampler.NbPoints(); ++i)
+               points.push_back(sampler.Value(i));
+         }
+         if (edgeExp.Current().Orientation() == TopAbs_REVERSED)
+            std::reverse(points.begin(), points.end());
+
+         // Consecutive edges share their end points
+         for (std::size_t i = count > 0 ? 1 : 0; i < points.size(); i++, count++) {
+            rBuffer.push_back(points[i].Coord(u + 1));
+            rBuffer.push_back(points[i].Coord(v + 1));
+         }
+      }
+      rBuffer[countAt] = count;
+   }
+
+   bool SliceStation(const TopTools_IndexedMapOfShape& faces, const std::vector<std::pair<double, double>>& ranges,
+      double station, const SliceOptions& options, std::vector<double>& rBuffer) {
+      rBuffer = { station, 0 };
+      BRep_Builder builder;
+      TopoDS_Compound crossing;
+      builder.MakeCompound(crossing);
+      int crossingCount = 0;
+      for (int i = 0; i < (int)ranges.size(); i++) {
+         if (ranges[i].first <= station && station <= ranges[i].second) {
+            builder.Add(crossing, faces(i + 1));
+            crossingCount++;
+         }
+      }
+      if (crossingCount == 0)
+         return true;
+
+      gp_Pnt origin(0, 0, 0);
+      origin.SetCoord(options.axis + 1, station);
+      BRepAlgoAPI_Section section(crossing, gp_Pln(origin, Axes[options.axis]), Standard_False);
+      section.Approximation(Standard_False);
+      section.ComputePCurveOn1(Standard_False);
+      section.SetRunParallel(Standard_False); // The parallelism is across the stations
+      section.Build();
+      if (!section.IsDone() || section.HasErrors())
+         return false;
+
+      Handle(TopTools_HSequenceOfShape) edges = new TopTools_HSequenceOfShape();
+      for (TopExp_Explorer edgeExp(section.Shape(), TopAbs_EDGE); edgeExp.More(); edgeExp.Next())
+         edges->Append(edgeExp.Current());
+      Handle(TopTools_HSequenceOfShape) wires;
+      ShapeAnalysis_FreeBounds::ConnectEdgesToWires(edges, options.tolerance, Standard_False, wires);
+      for (int i = 1; i <= wires->Length(); ++i)
+         AddPolyline(TopoDS::Wire(wires->Value(i)), options.axis, options.deflection, rBuffer);
+      rBuffer[1] = wires->Length();
+      return true;
+   }
+}
+
+std::vector<double> EvenStations(const TopoDS_Shape& shape, int axis, int count) {
+   std::vector<double> stations;
+   Bnd_Box box;
+   BRepBndLib::Add(shape, box, Standard_False);
+   if (box.IsVoid() || count <= 0)
+      return stations;
+   double min[3], max[3];
+   box.Get(min[0], min[1], min[2], max[0], max[1], max[2]);
+   double pitch = (max[axis] - min[axis]) / count;
+   for (int i = 0; i < count; i++)
+      stations.push_back(min[axis] + (i + 0.5) * pitch);
+   return stations;
+}
+
+bool SliceShape(const TopoDS_Shape& shape, const std::vector<double>& stations, const SliceOptions& options,
+   std::vector<double>& rBuffer, std::string& rError) {
+   rBuffer.clear();
+   rError.clear();
+   if (shape.IsNull() || options.axis < 0 || options.axis > 2)
+      return false;
+
+   TopTools_IndexedMapOfShape faces;
+   TopExp::MapShapes(shape, TopAbs_FACE, faces);
+   std::vector<std::pair<double, double>> ranges = FaceRanges(faces, options.axis, options.tolerance);
+
+   // One task per thread, each with its copy and every threads-th station. The copy keeps the
+   // order of the faces, so the ranges still apply
+   int tasks = std::max(1, std::min((int)stations.size(), Concurrency::JobThreads()));
+   std::vector<std::vector<double>> sections(stations.size());
+   std::atomic<bool> failed{ false };
+   std::mutex errorMutex;
+   auto fail = [&](const std::string& error) {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (rError.empty())
+         rError = error;
+      failed = true;
+   };
+   Concurrency::For(tasks, [&](int task) {
+      try {
+         TopoDS_Shape copy = BRepBuilderAPI_Copy(shape).Shape();
+         TopTools_IndexedMapOfShape copyFaces;
+         TopExp::MapShapes(copy, TopAbs_FACE, copyFaces);
+         for (std::size_t i = task; i < stations.size() && !failed; i += tasks) {
+            if (!SliceStation(copyFaces, ranges, stations[i], options, sections[i]))
+               fail("the section at station " + std::to_string(stations[i]) + " failed");
+         }
+      }
+      catch (const Standard_Failure& ex) {
+         fail(ex.GetMessageString());
+      }
+      catch (const std::exception& ex) {
+         // Nothing may escape a thread of the loop, bad_alloc included
+         fail(ex.what());
+      }
+   });
+   if (failed)
+      return false;
+
+   std::size_t size = 0;
+   for (const auto& section : sections)
+      size += section.size();
+   rBuffer.reserve(size);
+   for (const auto& section : sections)
+      rBuffer.insert(rBuffer.end(), section.begin(), section.end());
+   return true;
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+
+class TopoDS_Shape;
+
+// Planar sections of a shape at stations along one axis, to check flange heights and web
+// widths along a joined rail without exporting it
+struct SliceOptions {
+   int axis = 0;             // Normal of the cutting planes: 0 X, 1 Y, 2 Z
+   int evenStations = 100;   // Stations spread over the shape when the caller gives none, see EvenStations
+   double deflection = 0.05; // Curves of the sections split into segments, mm
+   double tolerance = 1e-4;  // Gap closed when chaining the section edges into polylines
+};
+
+// Stations spread evenly over the extent of the shape along the axis, half a pitch from the ends
+std::vector<double> EvenStations(const TopoDS_Shape& shape, int axis, int count);
+
+// Section the shape at every station, the stations spread over the job threads. Each thread
+// cuts its own copy of the shape, and only the faces whose box spans the station. Returns
+// false when a section failed, with the first failure in rError.
+//
+// rBuffer holds the stations one after the other, in the order given:
+//    station, polyline count, then per polyline: point count, u0, v0, u1, v1 ..
+// u and v are the coordinates in the cutting plane: Y and Z for X stations, Z and X for Y
+// stations, X and Y for Z stations. A closed polyline repeats its first point at the end
+bool SliceShape(const TopoDS_Shape& shape, const std::vector<double>& stations, const SliceOptions& options,
+   std::vector<double>& rBuffer, std::string& rError);